@@ -0,0 +1,94 @@
+#include "base/ByteSearch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+using namespace schwi;
+
+/**
+ * @brief 构造一个大约 size 字节的HTTP请求头
+ */
+std::string makeRequestHead(size_t size)
+{
+    std::string head = "GET /api/v1/items?id=12345&sort=desc HTTP/1.1\r\n"
+                       "Host: www.example.com\r\n"
+                       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+                       "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                       "Accept-Language: en-US,en;q=0.5\r\n"
+                       "Accept-Encoding: gzip, deflate, br\r\n"
+                       "Connection: keep-alive\r\n";
+    int index = 0;
+    while (head.size() + 4 < size)
+    {
+        head += fmt::format("X-Custom-Header-{}: {}\r\n", index++, std::string(24, 'v'));
+    }
+    head += "\r\n";
+    return head;
+}
+
+/**
+ * @brief 像HttpContext一样逐行查找CRLF, 返回找到的行数
+ */
+template <typename Find>
+size_t countLines(const std::string &head, Find find)
+{
+    size_t lines = 0;
+    const char *begin = head.data();
+    const char *end = head.data() + head.size();
+    while (true)
+    {
+        const char *crlf = find(begin, end);
+        if (crlf == end)
+        {
+            break;
+        }
+        ++lines;
+        begin = crlf + 2;
+    }
+    return lines;
+}
+
+template <typename Find>
+void bench(const char *name, const std::vector<std::string> &heads, Find find)
+{
+    const int kRounds = 200000;
+    size_t lines = 0;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRounds; ++i)
+    {
+        const std::string &head = heads[i % heads.size()];
+        lines += countLines(head, find);
+        bytes += head.size();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fmt::print("{:<12} {:8.1f} ns/head {:8.2f} GB/s (lines={})\n",
+               name, seconds * 1e9 / kRounds, bytes / seconds / 1e9, lines);
+}
+
+int main()
+{
+    std::vector<std::string> heads;
+    for (size_t size = 400; size <= 800; size += 100)
+    {
+        heads.push_back(makeRequestHead(size));
+    }
+
+    const char kCRLF[] = "\r\n";
+    bench("std::search", heads, [&](const char *begin, const char *end)
+          { return std::search(begin, end, kCRLF, kCRLF + 2); });
+
+    const char *names[] = {"scalar", "sse2", "avx2"};
+    for (ByteSearch::Isa isa : {ByteSearch::kScalar, ByteSearch::kSse2, ByteSearch::kAvx2})
+    {
+        if (ByteSearch::setIsa(isa))
+        {
+            bench(names[isa], heads, ByteSearch::findCRLF);
+        }
+    }
+    return 0;
+}
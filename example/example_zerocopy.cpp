@@ -0,0 +1,135 @@
+#include "net/TcpServer.hpp"
+#include "net/Buffer.hpp"
+#include "log/LogStream.hpp"
+#include "base/base.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+using namespace schwi;
+
+/**
+ * @brief 回环地址上的 MSG_ZEROCOPY 基准: 服务器反复发送同一块共享内存, 客户端读完丢弃
+ *
+ * 对每种消息大小比较普通发送与零拷贝发送的吞吐和服务器线程的CPU时间。
+ * 注意回环地址上内核会退回拷贝(copied 列), 真实网卡上零拷贝的收益更明显。
+ */
+struct Result
+{
+    double seconds;
+    double cpuSeconds;
+    size_t copied; // 内核退回拷贝的完成通知数
+};
+
+double threadCpuSeconds()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+Result run(uint16_t port, size_t messageSize, size_t totalBytes, bool zeroCopy)
+{
+    std::shared_ptr<char[]> payload(new char[messageSize]);
+    std::fill(payload.get(), payload.get() + messageSize, 'z');
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "ZeroCopyBench");
+    Result result{0, 0, 0};
+    size_t queued = 0;
+    double cpuStart = 0;
+
+    // 每次写完后再排队一批, 输出缓冲中始终只有少量消息
+    auto refill = [&](const TcpConnectionPtr &conn)
+    {
+        if (queued >= totalBytes)
+        {
+            result.copied = conn->zeroCopyCopied();
+            conn->shutdown();
+            return;
+        }
+        Buffer buf;
+        buf.setChained(true);
+        for (int i = 0; i < 8 && queued < totalBytes; ++i)
+        {
+            buf.append(std::shared_ptr<const char[]>(payload), messageSize);
+            queued += messageSize;
+        }
+        conn->send(&buf);
+    };
+
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            cpuStart = threadCpuSeconds();
+            conn->setChainedOutput(true);
+            if (zeroCopy)
+            {
+                conn->setZeroCopyThreshold(1);
+            }
+            conn->setWriteCompleteCallback(refill);
+            refill(conn);
+        }
+        else
+        {
+            result.cpuSeconds = threadCpuSeconds() - cpuStart;
+            loop.quit();
+        } });
+    server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+                              { buf->retrieveAll(); });
+    server.start();
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread client([&]
+                       {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0)
+        {
+            ::usleep(1000);
+        }
+        std::unique_ptr<char[]> buf(new char[1024 * 1024]);
+        while (::read(fd, buf.get(), 1024 * 1024) > 0)
+        {
+        }
+        ::close(fd); });
+    loop.loop();
+    client.join();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    auto logger = std::make_shared<Logger>(Logger::ERROR, std::make_shared<LogConsole>());
+    GlobalLogger::Instance().setLogger(logger);
+
+    const size_t totalBytes = (argc > 1 ? std::stoul(argv[1]) : 1024) * 1024 * 1024;
+    uint16_t port = 24000;
+
+    fmt::print("{:>10} {:>10} {:>10} {:>12} {:>8}\n", "size", "mode", "GB/s", "cpu s/GB", "copied");
+    for (size_t size : {4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024})
+    {
+        for (bool zeroCopy : {false, true})
+        {
+            Result r = run(port++, size, totalBytes, zeroCopy);
+            double gb = totalBytes / 1e9;
+            fmt::print("{:>10} {:>10} {:>10.2f} {:>12.3f} {:>8}\n",
+                       size, zeroCopy ? "zerocopy" : "copy", gb / r.seconds, r.cpuSeconds / gb,
+                       zeroCopy ? std::to_string(r.copied) : "-");
+        }
+    }
+    return 0;
+}
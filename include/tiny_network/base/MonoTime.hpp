@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <compare>
+
+#include "base/Timestamp.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 单调时间, 以 CLOCK_MONOTONIC 的微秒数表示, 不受系统时间调整影响
+     *
+     * 用于定时器和超时计算; 与 Timestamp(墙上时间) 不能直接比较, 需要时用 toTimestamp/fromTimestamp 换算。
+     */
+    class MonoTime
+    {
+    public:
+        MonoTime() : _microseconds(0) {}
+        explicit MonoTime(int64_t microseconds)
+            : _microseconds(microseconds) {}
+
+        auto operator<=>(const MonoTime &other) const = default;
+
+        /**
+         * @brief 获取当前单调时间, 启用 TscClock 后改为读取TSC
+         */
+        static MonoTime now();
+
+        int64_t microseconds() const { return _microseconds; }
+        bool valid() const { return _microseconds > 0; }
+
+        static MonoTime invalid() { return MonoTime(); }
+
+        /**
+         * @brief 换算为对应的墙上时间
+         */
+        Timestamp toTimestamp() const;
+
+        /**
+         * @brief 由墙上时间换算出对应的单调时间
+         */
+        static MonoTime fromTimestamp(Timestamp time);
+
+    private:
+        int64_t _microseconds;
+    };
+
+    /**
+     * @brief 将单调时间增加指定的秒数
+     */
+    inline MonoTime addTime(MonoTime time, double seconds)
+    {
+        int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+        return MonoTime(time.microseconds() + delta);
+    }
+
+    /**
+     * @brief 基于TSC的快速时钟, 启用时以 CLOCK_MONOTONIC 校准, 之后 MonoTime::now() 只需一次 rdtsc
+     *
+     * 只在支持 invariant TSC 的 x86 CPU 上可用; 设置环境变量 TINY_NETWORK_USE_TSC 时在启动时自动启用。
+     */
+    class TscClock
+    {
+    public:
+        /**
+         * @brief 校准并启用TSC时钟, 应在创建EventLoop之前调用
+         * @return CPU不支持 invariant TSC 时返回 false, 仍使用 clock_gettime
+         */
+        static bool enable();
+        static void disable();
+        static bool enabled();
+
+        static bool available(); // CPU是否支持 invariant TSC
+        static MonoTime now();
+        static double cyclesPerMicrosecond();
+    };
+} // namespace schwi
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "base/noncopyable.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 每个EventLoop一个的缓冲区内存池, 只能在所属loop线程中使用
+     *
+     * 按2的幂分为若干大小等级(1KiB ~ 128KiB), 每级维护一个空闲链表, 超过最大等级的直接向系统申请。
+     * 借出的内存都由 malloc 分配, 用 release 脱离内存池后可以在任意线程用 free 释放。
+     * 内存不做零初始化。trim() 释放上一个周期内始终空闲的块, 使突发流量过后内存能还给系统。
+     */
+    class BufferPool : noncopyable
+    {
+    public:
+        static constexpr size_t kMinClassSize = 1024;
+        static constexpr int kNumClasses = 8;
+        static constexpr size_t kMaxClassSize = kMinClassSize << (kNumClasses - 1);
+        static constexpr size_t kMaxCachedBytesPerClass = 16 * 1024 * 1024; // 每级最多缓存的空闲内存
+        static constexpr size_t kScratchSize = 64 * 1024;
+
+        BufferPool() = default;
+        ~BufferPool();
+
+        /**
+         * @brief 本loop共用的临时读缓冲, 大小为 kScratchSize, 不做零初始化
+         */
+        char *scratch();
+
+        /**
+         * @brief 借出至少 size 字节的内存
+         * @param capacity 返回实际大小, 归还时需原样传回
+         */
+        char *allocate(size_t size, size_t *capacity);
+
+        /**
+         * @brief 归还 allocate 借出的内存
+         */
+        void deallocate(char *data, size_t capacity);
+
+        /**
+         * @brief 借出的内存不再归还, 之后由持有者用 free 释放
+         */
+        void release(size_t capacity) { _borrowedBytes -= capacity; }
+
+        /**
+         * @brief 释放自上次trim以来一直没有被借出的空闲块
+         */
+        void trim();
+
+        size_t borrowedBytes() const { return _borrowedBytes; } // 借出中的字节数
+        size_t cachedBytes() const { return _cachedBytes; }     // 池中空闲的字节数
+
+        static size_t roundUp(size_t size); // 向上取整到所属等级的大小
+
+    private:
+        struct SizeClass
+        {
+            std::vector<char *> free;
+            size_t minFree = 0; // 本周期内空闲块数的最低点, 这些块整个周期都没有用到
+        };
+
+        static int classIndex(size_t capacity);
+
+        SizeClass _classes[kNumClasses];
+        size_t _borrowedBytes = 0;
+        size_t _cachedBytes = 0;
+        char *_scratch = nullptr;
+    };
+} // namespace schwi
@@ -5,19 +5,19 @@
 #include <condition_variable>
 
 #include "base/noncopyable.hpp"
+#include "net/EventLoop.hpp"
 #include "base/Thread.hpp"
 
 namespace schwi
 {
-    class EventLoop;
-
     class EventLoopThread : noncopyable
     {
     public:
         using ThreadInitCallback = std::function<void(EventLoop *)>;
 
         EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback(),
-                        const std::string &name = std::string());
+                        const std::string &name = std::string(),
+                        PollerBackend backend = PollerBackend::kDefault);
         ~EventLoopThread();
 
         EventLoop *startLoop();
@@ -31,5 +31,6 @@ namespace schwi
         std::mutex _mutex;
         std::condition_variable _cond;
         ThreadInitCallback _callback;
+        PollerBackend _backend;
     };
 } // namespace schwi
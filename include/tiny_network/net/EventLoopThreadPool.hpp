@@ -5,9 +5,10 @@
 #include <vector>
 #include <string>
 
+#include "net/EventLoop.hpp"
+
 namespace schwi
 {
-    class EventLoop;
     class EventLoopThread;
 
     class EventLoopThreadPool
@@ -19,6 +20,8 @@ namespace schwi
         ~EventLoopThreadPool();
 
         void setThreadNum(int numThreads) { _numThreads = numThreads; }
+        void setBusyPoll(int spinMicros, int socketBusyPollMicros = 0); // 设置所有IO loop的忙轮询参数
+        void setPollerBackend(PollerBackend backend) { _backend = backend; } // IO loop的事件通知后端, 需要在start之前调用
         void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
         EventLoop *getNextLoop();
@@ -33,6 +36,9 @@ namespace schwi
         std::string _name;
         bool _started;
         int _numThreads;
+        int _busyPollMicros;
+        int _socketBusyPollMicros;
+        PollerBackend _backend;
         size_t _next;
         std::vector<std::unique_ptr<EventLoopThread>> _threads;
         std::vector<EventLoop *> _loops;
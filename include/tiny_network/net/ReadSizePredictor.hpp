@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+
+namespace schwi
+{
+    /**
+     * @brief 根据最近几次读取的字节数预测下一次读取的大小 (参考 Netty AdaptiveRecvByteBufAllocator)
+     *
+     * 候选大小为 64B ~ 64KiB 的2的幂; 读满预测值时立即放大两级, 连续两次不超过下一级才缩小一级,
+     * 使缓冲区快速跟上突发流量, 又不会因为偶尔的小包频繁抖动。
+     */
+    class ReadSizePredictor
+    {
+    public:
+        static constexpr size_t kMinSize = 64;
+        static constexpr int kMaxIndex = 10; // 64 << 10 = 64KiB
+        static constexpr int kIndexIncrement = 2;
+        static constexpr int kIndexDecrement = 1;
+
+        explicit ReadSizePredictor(size_t initialSize = 1024)
+            : _index(indexOf(initialSize)),
+              _decreaseNow(false)
+        {
+        }
+
+        size_t nextReadSize() const { return sizeAt(_index); }
+
+        /**
+         * @brief 记录一次实际读取的字节数
+         */
+        void record(size_t actual)
+        {
+            if (actual <= sizeAt(_index > kIndexDecrement ? _index - kIndexDecrement : 0))
+            {
+                if (_decreaseNow)
+                {
+                    _index = _index > kIndexDecrement ? _index - kIndexDecrement : 0;
+                    _decreaseNow = false;
+                }
+                else
+                {
+                    _decreaseNow = true;
+                }
+            }
+            else if (actual >= nextReadSize())
+            {
+                _index = _index + kIndexIncrement < kMaxIndex ? _index + kIndexIncrement : kMaxIndex;
+                _decreaseNow = false;
+            }
+        }
+
+    private:
+        static size_t sizeAt(int index) { return kMinSize << index; }
+
+        static int indexOf(size_t size)
+        {
+            int index = 0;
+            while (index < kMaxIndex && sizeAt(index) < size)
+            {
+                ++index;
+            }
+            return index;
+        }
+
+        int _index;
+        bool _decreaseNow;
+    };
+} // namespace schwi
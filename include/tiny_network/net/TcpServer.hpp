@@ -52,6 +52,29 @@ namespace schwi
 
         void start();
         void setThreadNum(int numThreads);
+        void setBusyPoll(int spinMicros, int socketBusyPollMicros = 0); // 设置base loop与所有IO loop的忙轮询参数
+        void setEdgeTriggered(bool on); // 监听socket与新连接都以边沿触发方式注册, 需要在start之前调用
+        // IO loop的事件通知后端, base loop 由创建者指定; 选择 io_uring 时连接的收发经由 io_uring 完成, 需要在start之前调用
+        void setPollerBackend(PollerBackend backend) { _threadPool->setPollerBackend(backend); }
+
+        /**
+         * @brief 限制发送带宽(字节/秒): perConnection 限制每个连接, total 限制所有连接之和, 不大于 0 表示不限制
+         *
+         * 总带宽由各连接轮流取用, 每次最多取一个份额。只对之后建立的连接生效, 需要在start之前调用
+         */
+        void setSendRateLimit(double perConnection, double total = 0);
+
+        /**
+         * @brief 连接的空闲/读/写超时(秒, 0 表示不限制), 含义见 TcpConnection::setTimeouts, 只对之后建立的连接生效
+         */
+        void setTimeouts(int idleSeconds, int readSeconds = 0, int writeSeconds = 0);
+
+        /**
+         * @brief 新连接的fd超过 RLIMIT_NOFILE 的 ratio 倍, 或 accept 遇到 EMFILE 时, 强制关闭最久没有活动的一个连接, 0 表示关闭
+         *
+         * 在所有loop中选择LRU尾部最旧的那个loop淘汰, 该loop没有可淘汰的连接时依次尝试其余loop。需要在start之前调用
+         */
+        void setEvictWhenNearFdLimit(double ratio = 0.9) { _fdLimitRatio = ratio; }
         EventLoop *getLoop() const { return _loop; }
         const std::string &ipPort() const { return _ipPort; }
         const std::string &name() const { return _name; }
@@ -60,6 +83,8 @@ namespace schwi
         void newConnection(int sockfd, const InetAddress &peerAddr);
         void removeConnection(const TcpConnectionPtr &conn);
         void removeConnectionInLoop(const TcpConnectionPtr &conn);
+        void evictLeastRecentlyActive();
+        void handleFdExhausted();
 
         using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
 
@@ -77,6 +102,15 @@ namespace schwi
 
         std::atomic<int> _started;
         int _nextConnId;
+        bool _edgeTriggered;
+        double _connectionSendRate;
+        std::shared_ptr<TokenBucket> _sendLimiter; // 所有连接共用, 为空表示不限制总带宽
+        int _idleTimeout;
+        int _readTimeout;
+        int _writeTimeout;
+        double _fdLimitRatio;
+        int _evictFd; // 新连接的fd不小于该值时淘汰一个连接, 0 表示不淘汰
+        bool _evictPending; // accept 遇到 EMFILE 后已发起淘汰, 有连接移除前不再重复淘汰
         ConnectionMap _connections;
     };
 } // namespace schwi
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <functional>
+#include <string_view>
+
+#include "base/noncopyable.hpp"
+#include "base/Timestamp.hpp"
+#include "net/Callback.hpp"
+
+namespace schwi
+{
+    class Buffer;
+
+    /**
+     * @brief 消息分帧编解码器的基类
+     *
+     * 把 onMessage 设为 TcpServer 的消息回调后, 每收到一个完整帧回调一次 FrameCallback,
+     * 传入的帧内容直接指向输入缓冲区, 只在回调期间有效。
+     * 帧长度已知但数据未收全时, 把连接的 SO_RCVLOWAT 设为缺少的字节数, 大消息到齐前不再唤醒loop。
+     * 编码器本身无状态, 可以被多个连接和线程共用。
+     */
+    class FrameCodec : noncopyable
+    {
+    public:
+        using FrameCallback = std::function<void(const TcpConnectionPtr &, std::string_view, Timestamp)>;
+
+        static constexpr size_t kDefaultMaxFrameLength = 64 * 1024 * 1024;
+        static constexpr size_t kRecvLowatThreshold = 16 * 1024; // 缺少的字节数超过该值才设置SO_RCVLOWAT
+        static constexpr int kMaxRecvLowat = 256 * 1024;         // SO_RCVLOWAT 的上限, 不超过接收缓冲区的一半
+        static constexpr size_t kMaxHeaderLength = 8;           // 各编码器帧头的最大长度
+
+        FrameCodec(const FrameCallback &cb, size_t maxFrameLength);
+        virtual ~FrameCodec() = default;
+
+        void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+        /**
+         * @brief 编码并发送一帧, 帧头、内容和帧尾作为多段内存一起发送, 不拷贝到临时缓冲区
+         */
+        void send(const TcpConnectionPtr &conn, std::string_view payload) const;
+
+        /**
+         * @brief 把 buf 中全部可读数据编码为一帧, 帧头写入预留区
+         *
+         * 调用方可以先用 Buffer::appendFormat 等接口直接序列化到 buf, 再编码后整体发送。
+         * @return 数据超过最大帧长时返回 false, buf 不变
+         */
+        bool encode(Buffer *buf) const;
+
+        void setRecvLowatEnabled(bool on) { _recvLowatEnabled = on; }
+        size_t maxFrameLength() const { return _maxFrameLength; }
+
+    protected:
+        enum DecodeResult
+        {
+            kComplete,
+            kIncomplete,
+            kError
+        };
+
+        /**
+         * @brief 一帧在缓冲区中的布局: 帧头 + 内容 + 帧尾
+         */
+        struct Frame
+        {
+            size_t headerLength;
+            size_t payloadLength;
+            size_t trailerLength;
+
+            size_t totalLength() const { return headerLength + payloadLength + trailerLength; }
+        };
+
+        /**
+         * @brief 内容前后附加的帧头和帧尾
+         */
+        struct Envelope
+        {
+            unsigned char header[kMaxHeaderLength];
+            size_t headerLength;
+            std::string_view trailer;
+        };
+
+        /**
+         * @brief 生成内容长度为 payloadLength 的帧的帧头和帧尾
+         * @return 超过最大帧长或长度字段放不下时返回 false
+         */
+        virtual bool envelope(size_t payloadLength, Envelope *env) const = 0;
+
+        /**
+         * @brief 从 [data, data + len) 的开头解码一帧
+         * @param scanned 开头已确认不含帧边界的字节数, 返回 kIncomplete 时更新, 下次从这里续扫
+         * @return kIncomplete 时若已知整帧长度则填好 frame, 否则 frame->totalLength() 为0
+         */
+        virtual DecodeResult decode(const char *data, size_t len, Frame *frame, size_t *scanned) const = 0;
+
+        const size_t _maxFrameLength;
+
+    private:
+        void updateRecvLowat(const TcpConnectionPtr &conn, size_t missing) const;
+
+        FrameCallback _frameCallback;
+        bool _recvLowatEnabled;
+    };
+} // namespace schwi
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "net/codec/FrameCodec.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 定长长度头分帧: 1/2/4/8 字节的大端或小端长度 + 内容, 长度不包括帧头本身
+     */
+    class LengthFieldCodec : public FrameCodec
+    {
+    public:
+        enum Endian
+        {
+            kBigEndian,
+            kLittleEndian
+        };
+
+        LengthFieldCodec(const FrameCallback &cb,
+                         int lengthFieldWidth = 4,
+                         Endian endian = kBigEndian,
+                         size_t maxFrameLength = kDefaultMaxFrameLength);
+
+        int lengthFieldWidth() const { return _width; }
+        Endian endian() const { return _endian; }
+
+    protected:
+        bool envelope(size_t payloadLength, Envelope *env) const override;
+        DecodeResult decode(const char *data, size_t len, Frame *frame, size_t *scanned) const override;
+
+    private:
+        const int _width;
+        const Endian _endian;
+    };
+} // namespace schwi
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "net/codec/FrameCodec.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 变长长度头分帧: protobuf 风格的 base-128 varint 长度 + 内容
+     *
+     * 帧头最长8字节(可表示 2^56 - 1), 正好放进 Buffer 的预留区。
+     */
+    class VarintCodec : public FrameCodec
+    {
+    public:
+        static constexpr int kMaxVarintLength = 8;
+
+        explicit VarintCodec(const FrameCallback &cb, size_t maxFrameLength = kDefaultMaxFrameLength);
+
+    protected:
+        bool envelope(size_t payloadLength, Envelope *env) const override;
+        DecodeResult decode(const char *data, size_t len, Frame *frame, size_t *scanned) const override;
+    };
+} // namespace schwi
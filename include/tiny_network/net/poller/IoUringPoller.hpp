@@ -0,0 +1,187 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <sys/types.h>
+#include <linux/io_uring.h>
+
+#include "net/poller/Poller.hpp"
+#include "net/Buffer.hpp"
+#include "base/Timestamp.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 基于 io_uring 的 Poller, 同时提供基于完成的收发
+     *
+     * 水平触发的Channel以单次 POLL_ADD 请求挂载，触发后在下一次 poll() 时重新挂上，
+     * 保持与 EpollPoller 相同的水平触发语义；边沿触发的Channel(回调读写到EAGAIN)
+     * 在内核支持时(5.13+)使用 IORING_POLL_ADD_MULTI 一直挂着, 每次事件不再消耗一个SQE。
+     *
+     * 内核支持提供缓冲环(5.19+)时, enableCompletionIo 的Channel改为基于完成的收发:
+     * 关注读时挂一个从缓冲环取内存的多次触发 recv, 收到的数据在 takeReceived 中交给调用方;
+     * 缓冲环注册成功却取不到内存的内核上, 同一组缓冲改以 PROVIDE_BUFFERS 交给内核;
+     * send 提交的数据由 Poller 持有到发完, 分段以链接的 SEND 请求按顺序发送。
+     * 完成事件以 EPOLLIN/EPOLLOUT 交给Channel的回调, 写关注只在没有发送请求时才以 POLL_ADD 等待。
+     * 所有请求的增删改与等待合并在同一次 io_uring_enter 中完成。
+     */
+    class IoUringPoller : public Poller
+    {
+    public:
+        IoUringPoller(EventLoop *loop);
+        ~IoUringPoller() override;
+
+        Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+        void updateChannel(Channel *channel) override;
+        void removeChannel(Channel *channel) override;
+
+        static bool available(); // 内核是否支持所需的 io_uring 特性
+
+        bool multishot() const { return _multishot; }     // 是否支持多次触发的 POLL_ADD
+        uint64_t armedPolls() const { return _armedPolls; } // 提交过的 POLL_ADD 请求数
+
+        bool completionIo() const { return _recvBuffers != nullptr; } // 是否支持基于完成的收发
+        uint64_t submittedRecvs() const { return _submittedRecvs; }  // 提交过的 recv 请求数
+        uint64_t submittedSends() const { return _submittedSends; }  // 提交过的 SEND 请求数
+
+        /**
+         * @brief Channel 的读写改为基于完成的 recv/send, 直到 removeChannel, 需要 completionIo()
+         */
+        void enableCompletionIo(Channel *channel);
+
+        /**
+         * @brief 按接收顺序把已收到的数据追加到 buf 并把内存还给缓冲环, 凑够 maxBytes 后停止
+         * @return 追加的字节数; 没有数据时对端已关闭返回 0, 出错返回 -1 并设置 savedErrno, 暂时没有数据为 EAGAIN
+         */
+        ssize_t takeReceived(Channel *channel, Buffer *buf, int *savedErrno, size_t maxBytes);
+
+        /**
+         * @brief 接管 data 并发送, 发完或出错时Channel收到 EPOLLOUT, 之前不能再次调用
+         */
+        void send(Channel *channel, Buffer &&data);
+
+        /**
+         * @brief 取走已结束的发送
+         * @return 发送已结束, 出错时设置 savedErrno, 否则为 0
+         */
+        bool takeSent(Channel *channel, int *savedErrno);
+
+    private:
+        static const unsigned kRingEntries = 1024;
+        static const unsigned kRecvBuffers = 256;           // 缓冲环中的接收缓冲个数, 需为2的幂
+        static const size_t kRecvBufferSize = 8 * 1024;     // 每个接收缓冲的大小
+        static const uint16_t kBufferGroup = 0;
+        static const size_t kMaxSendSegments = 16;          // 一次链接提交的 SEND 请求数上限
+
+        enum Op
+        {
+            kPollOp,
+            kRecvOp,
+            kSendOp,
+        };
+
+        /**
+         * @brief 基于完成收发的Channel的状态, 单独分配, 发送未结束时地址不变
+         */
+        struct CompletionState
+        {
+            uint64_t recvTag = 0;     // 当前 recv 请求的 user_data
+            bool recvArmed = false;   // 是否有未结束的 recv 请求
+            bool recvCancelling = false; // 已提交取消, 等待 recv 结束
+            bool recvClosed = false;  // 已收到对端关闭或错误, 不再挂 recv
+            bool recvStarved = false; // 缓冲用完(ENOBUFS), 等有缓冲归还时再挂 recv
+            int recvResult = 1;       // 0 表示对端关闭, 负数为错误, 1 表示没有
+            std::vector<std::pair<uint16_t, uint32_t>> received; // 已收到待取走的接收缓冲(编号, 长度)
+
+            uint64_t sendTag = 0;       // 当前一批 SEND 请求共用的 user_data
+            Buffer sending{static_cast<BufferPool *>(nullptr)}; // 发送中的数据, 结束前不修改
+            bool sendActive = false;    // send 之后还没有被 takeSent 取走
+            unsigned sendInflight = 0;  // 本批未完成的 SEND 请求数
+            size_t sendBytes = 0;       // 本批已发出的字节数
+            int sendError = 0;
+            bool sendDone = false;      // 已发完或出错
+        };
+
+        /**
+         * @brief 每个fd在 io_uring 上的挂载状态
+         */
+        struct PollState
+        {
+            uint64_t tag = 0;        // 当前 POLL_ADD 请求的 user_data
+            int armedEvents = 0;     // 已提交给内核的关注事件
+            bool armed = false;      // 是否有未完成的 POLL_ADD 请求
+            bool multishot = false;  // 当前请求是否为 IORING_POLL_ADD_MULTI
+            bool pendingArm = false; // 是否已在 _pendingArms 中等待挂载
+            int revents = 0;         // 本次 poll 中累积的事件
+            std::unique_ptr<CompletionState> completion; // 基于完成的收发, 没有开启时为空
+        };
+
+        void setupRing();
+        void setupBufferRing();
+        bool registerBufferRing();
+        bool probeBufferRing();
+        void makeRoom(unsigned count);
+        io_uring_sqe *getSqe();
+        PollState &state(int fd);
+        uint64_t nextTag(int fd, Op op);
+        int polledEvents(const PollState &state, const Channel *channel) const;
+        void applyInterest(int fd, PollState &state);
+        void armPoll(int fd, PollState &state, int events, bool multishot);
+        void cancelPoll(PollState &state);
+        void cancelRequest(uint64_t tag, bool all);
+        void armRecv(int fd, CompletionState &completion);
+        void submitSend(int fd, CompletionState &completion);
+        bool useMultishot(const Channel *channel) const { return _multishot && channel->edgeTriggered(); }
+        void scheduleArm(int fd, PollState &state);
+        int submitAndWait(int timeoutMs);
+        void fillActiveChannels(ChannelList *activeChannels);
+        void handlePollCompletion(int fd, PollState &state, const io_uring_cqe *cqe);
+        void handleRecvCompletion(int fd, PollState &state, const io_uring_cqe *cqe);
+        void handleSendCompletion(int fd, PollState &state, const io_uring_cqe *cqe);
+        void activate(int fd, PollState &state, int events);
+        char *recvBuffer(uint16_t bid) const { return _recvBuffers + static_cast<size_t>(bid) * kRecvBufferSize; }
+        void recycleBuffer(uint16_t bid);
+        void publishBuffers();
+
+        int _ringfd;
+        unsigned _sqEntries;
+        unsigned _cqEntries;
+
+        void *_sqRing;
+        size_t _sqRingSize;
+        void *_cqRing;
+        size_t _cqRingSize;
+        io_uring_sqe *_sqes;
+        size_t _sqesSize;
+
+        unsigned *_sqHead;
+        unsigned *_sqTail;
+        unsigned *_sqMask;
+        unsigned *_sqArray;
+        unsigned *_cqHead;
+        unsigned *_cqTail;
+        unsigned *_cqMask;
+        io_uring_cqe *_cqes;
+
+        unsigned _sqLocalTail; // 已填写但尚未提交的SQE尾指针
+        uint32_t _nextGeneration;
+        bool _multishot;
+        uint64_t _armedPolls;
+
+        io_uring_buf_ring *_bufferRing; // 注册给内核的接收缓冲环, 不支持时为空
+        char *_recvBuffers;             // 接收缓冲, 不支持基于完成的收发时为空
+        uint16_t _bufferTail;     // 已填写但尚未发布的缓冲环尾指针
+        bool _provideBuffers;     // 缓冲环不可用, 以 IORING_OP_PROVIDE_BUFFERS 归还缓冲
+        std::vector<uint16_t> _returnedBuffers; // 以 PROVIDE_BUFFERS 归还时尚未提交的缓冲编号
+        bool _recvMultishot;      // 内核是否支持多次触发的 recv (6.0+)
+        uint64_t _submittedRecvs;
+        uint64_t _submittedSends;
+
+        std::vector<PollState> _states; // 以fd为下标, 与 _channels 对应
+        std::vector<int> _pendingArms;  // 触发过或关注事件变化后需要重新挂载的fd
+        std::vector<int> _activeFds;    // 本次 poll 中有事件的fd
+        std::vector<int> _starvedFds;   // recv 因缓冲用完结束, 等待缓冲归还的fd
+        std::unordered_map<uint64_t, std::unique_ptr<CompletionState>> _orphanSends; // Channel移除时还没结束的发送
+    };
+} // namespace schwi
@@ -1,8 +1,9 @@
 #pragma once
 
 #include <functional>
+#include <atomic>
 #include "base/noncopyable.hpp"
-#include "base/Timestamp.hpp"
+#include "base/MonoTime.hpp"
 
 namespace schwi
 {
@@ -10,11 +11,12 @@ namespace schwi
     {
     public:
         using TimerCallback = std::function<void()>;
-        Timer(TimerCallback cb, Timestamp when, double interval)
+        Timer(TimerCallback cb, MonoTime when, double interval)
             : _callback(std::move(cb)),
               _expiration(when),
               _interval(interval),
-              _repeat(interval > 0.0)
+              _repeat(interval > 0.0),
+              _sequence(++_numCreated)
         {
         }
 
@@ -23,14 +25,22 @@ namespace schwi
             _callback();
         }
 
-        Timestamp expiration() const { return _expiration; }
+        MonoTime expiration() const { return _expiration; }
+        double interval() const { return _interval; }
         bool repeat() const { return _repeat; }
-        void restart(Timestamp now); // 重启定时器
+        int64_t sequence() const { return _sequence; }
+        void restart(MonoTime now);                                  // 重启定时器
+        void reset(TimerCallback cb, MonoTime when, double interval); // 复用定时器对象, 会分配新的序号
+
+        static int64_t numCreated() { return _numCreated; }
 
     private:
-        const TimerCallback _callback; // 定时器回调函数
-        Timestamp _expiration;         // 下一次的超时时刻
-        const double _interval;        // 超时时间间隔，如果是一次性定时器，该值为0
-        const bool _repeat;            // 是否重复(false 表示是一次性定时器)
+        TimerCallback _callback; // 定时器回调函数
+        MonoTime _expiration;    // 下一次的超时时刻
+        double _interval;        // 超时时间间隔，如果是一次性定时器，该值为0
+        bool _repeat;            // 是否重复(false 表示是一次性定时器)
+        int64_t _sequence;       // 全局唯一序号, 用于识别TimerId是否过期
+
+        static std::atomic_int64_t _numCreated;
     };
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+namespace schwi
+{
+    class Timer;
+
+    /**
+     * @brief 定时器标识, 用于取消定时器
+     */
+    class TimerId
+    {
+    public:
+        TimerId()
+            : _timer(nullptr),
+              _sequence(0)
+        {
+        }
+
+        TimerId(Timer *timer, int64_t sequence)
+            : _timer(timer),
+              _sequence(sequence)
+        {
+        }
+
+        bool valid() const { return _timer != nullptr; }
+
+        Timer *timer() const { return _timer; }
+        int64_t sequence() const { return _sequence; }
+
+    private:
+        Timer *_timer;     // 定时器对象, 可能已失效, 只能在定时器队列内结合序号使用
+        int64_t _sequence; // 创建时的序号
+    };
+} // namespace schwi
\ No newline at end of file
@@ -3,35 +3,45 @@
 #include <vector>
 #include <set>
 
-#include "base/Timestamp.hpp"
+#include "base/MonoTime.hpp"
 #include "net/Channel.hpp"
+#include "timer/ITimerQueue.hpp"
 
 namespace schwi
 {
     class EventLoop;
     class Timer;
 
-    class TimerQueue
+    /**
+     * @brief 基于 std::set 的高精度定时器队列, 由timerfd按最早超时时刻唤醒
+     *
+     * useTimerfd 为false时不创建timerfd, 由EventLoop根据 nextExpiration() 计算poll超时并调用 processExpired()
+     */
+    class TimerQueue : public ITimerQueue
     {
     public:
-        using TimerCallback = std::function<void()>;
+        TimerQueue(EventLoop *loop, bool useTimerfd = true);
+        ~TimerQueue() override;
 
-        TimerQueue(EventLoop *loop);
-        ~TimerQueue();
-
-        void addTimer(const TimerCallback &cb, Timestamp when, double interval);
+        TimerId addTimer(TimerCallback cb, MonoTime when, double interval) override;
+        void cancel(TimerId timerId) override;
+        MonoTime nextExpiration() const override;
+        void processExpired(MonoTime now) override;
 
     private:
-        using Entry = std::pair<Timestamp, Timer *>;
+        using Entry = std::pair<MonoTime, Timer *>;
         using TimerList = std::set<Entry>;
+        using ActiveTimer = std::pair<Timer *, int64_t>;
+        using ActiveTimerSet = std::set<ActiveTimer>;
 
         void addTimerInLoop(Timer *timer);
+        void cancelInLoop(TimerId timerId);
 
         void handleRead();
-        void resetTimerfd(int timerfd, Timestamp expiration);
+        void resetTimerfd(int timerfd, MonoTime expiration);
 
-        std::vector<Entry> getExpired(Timestamp now);
-        void reset(const std::vector<Entry> &expired, Timestamp now);
+        std::vector<Entry> getExpired(MonoTime now);
+        void reset(const std::vector<Entry> &expired, MonoTime now);
 
         bool insert(Timer *timer);
 
@@ -40,6 +50,8 @@ namespace schwi
         Channel _timerfdChannel;
         TimerList _timers;
 
+        ActiveTimerSet _activeTimers;    // 按对象地址索引的有效定时器, 用于取消
+        ActiveTimerSet _cancelingTimers; // 回调执行期间被取消的定时器
         bool _callingExpiredTimers;
     };
 } // namespace schwi
\ No newline at end of file
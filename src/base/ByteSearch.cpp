@@ -0,0 +1,206 @@
+#include "base/ByteSearch.hpp"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCHWI_HAS_X86_SIMD 1
+#else
+#define SCHWI_HAS_X86_SIMD 0
+#endif
+
+namespace schwi
+{
+    namespace
+    {
+        const char *findByteScalar(const char *begin, const char *end, char c)
+        {
+            const void *p = ::memchr(begin, c, end - begin);
+            return p != nullptr ? static_cast<const char *>(p) : end;
+        }
+
+        const char *findBytesScalar(const char *begin, const char *end, char a, char b)
+        {
+            for (const char *p = begin; p < end; ++p)
+            {
+                if (*p == a || *p == b)
+                {
+                    return p;
+                }
+            }
+            return end;
+        }
+
+        /**
+         * @brief 先用 findByte 找 '\n' 再检查前一个字节, 文本协议中 '\n' 几乎总是紧跟在 '\r' 之后,
+         * 一次向量比较即可, 比同时比较两个字节更快
+         */
+        template <const char *(*FindByte)(const char *, const char *, char)>
+        const char *findCRLFByLF(const char *begin, const char *end)
+        {
+            if (end - begin < 2)
+            {
+                return end;
+            }
+            const char *p = begin + 1;
+            while (p < end)
+            {
+                p = FindByte(p, end, '\n');
+                if (p == end)
+                {
+                    break;
+                }
+                if (p[-1] == '\r')
+                {
+                    return p - 1;
+                }
+                ++p;
+            }
+            return end;
+        }
+
+#if SCHWI_HAS_X86_SIMD
+        __attribute__((target("sse2"))) const char *findByteSse2(const char *begin, const char *end, char c)
+        {
+            const __m128i needle = _mm_set1_epi8(c);
+            const char *p = begin;
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+                if (mask != 0)
+                {
+                    return p + __builtin_ctz(mask);
+                }
+            }
+            return findByteScalar(p, end, c);
+        }
+
+        __attribute__((target("sse2"))) const char *findBytesSse2(const char *begin, const char *end, char a, char b)
+        {
+            const __m128i needleA = _mm_set1_epi8(a);
+            const __m128i needleB = _mm_set1_epi8(b);
+            const char *p = begin;
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                __m128i eq = _mm_or_si128(_mm_cmpeq_epi8(chunk, needleA), _mm_cmpeq_epi8(chunk, needleB));
+                int mask = _mm_movemask_epi8(eq);
+                if (mask != 0)
+                {
+                    return p + __builtin_ctz(mask);
+                }
+            }
+            return findBytesScalar(p, end, a, b);
+        }
+
+        __attribute__((target("avx2"))) const char *findByteAvx2(const char *begin, const char *end, char c)
+        {
+            const __m256i needle = _mm256_set1_epi8(c);
+            const char *p = begin;
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+                if (mask != 0)
+                {
+                    return p + __builtin_ctz(mask);
+                }
+            }
+            return findByteSse2(p, end, c);
+        }
+
+        __attribute__((target("avx2"))) const char *findBytesAvx2(const char *begin, const char *end, char a, char b)
+        {
+            const __m256i needleA = _mm256_set1_epi8(a);
+            const __m256i needleB = _mm256_set1_epi8(b);
+            const char *p = begin;
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i eq = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, needleA), _mm256_cmpeq_epi8(chunk, needleB));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+                if (mask != 0)
+                {
+                    return p + __builtin_ctz(mask);
+                }
+            }
+            return findBytesSse2(p, end, a, b);
+        }
+#endif
+
+        /**
+         * @brief 当前使用的一组实现
+         */
+        struct Kernels
+        {
+            ByteSearch::Isa isa;
+            const char *(*findByte)(const char *, const char *, char);
+            const char *(*findBytes)(const char *, const char *, char, char);
+            const char *(*findCRLF)(const char *, const char *);
+        };
+
+        Kernels kernelsFor(ByteSearch::Isa isa)
+        {
+            switch (isa)
+            {
+#if SCHWI_HAS_X86_SIMD
+            case ByteSearch::kAvx2:
+                return Kernels{isa, findByteAvx2, findBytesAvx2, findCRLFByLF<findByteAvx2>};
+            case ByteSearch::kSse2:
+                return Kernels{isa, findByteSse2, findBytesSse2, findCRLFByLF<findByteSse2>};
+#endif
+            default:
+                return Kernels{ByteSearch::kScalar, findByteScalar, findBytesScalar, findCRLFByLF<findByteScalar>};
+            }
+        }
+
+        Kernels g_kernels = kernelsFor(ByteSearch::detectIsa());
+    } // namespace
+
+    const char *ByteSearch::findByte(const char *begin, const char *end, char c)
+    {
+        return g_kernels.findByte(begin, end, c);
+    }
+
+    const char *ByteSearch::findBytes(const char *begin, const char *end, char a, char b)
+    {
+        return g_kernels.findBytes(begin, end, a, b);
+    }
+
+    const char *ByteSearch::findCRLF(const char *begin, const char *end)
+    {
+        return g_kernels.findCRLF(begin, end);
+    }
+
+    ByteSearch::Isa ByteSearch::isa()
+    {
+        return g_kernels.isa;
+    }
+
+    ByteSearch::Isa ByteSearch::detectIsa()
+    {
+#if SCHWI_HAS_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return kAvx2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return kSse2;
+        }
+#endif
+        return kScalar;
+    }
+
+    bool ByteSearch::setIsa(Isa isa)
+    {
+        if (isa > detectIsa())
+        {
+            return false;
+        }
+        g_kernels = kernelsFor(isa);
+        return true;
+    }
+} // namespace schwi
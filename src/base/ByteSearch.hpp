@@ -0,0 +1,29 @@
+#pragma once
+
+namespace schwi
+{
+    /**
+     * @brief 字节查找, 运行时按CPU选择 AVX2 / SSE2 / 标量实现
+     *
+     * 所有函数在 [begin, end) 内查找, 找不到时返回 end。
+     */
+    class ByteSearch
+    {
+    public:
+        enum Isa
+        {
+            kScalar,
+            kSse2,
+            kAvx2
+        };
+
+        static const char *findByte(const char *begin, const char *end, char c);
+        static const char *findBytes(const char *begin, const char *end, char a, char b); // 查找 a 或 b 第一次出现的位置
+        static const char *findCRLF(const char *begin, const char *end);                  // 返回 "\r\n" 中 '\r' 的位置
+        static const char *findEOL(const char *begin, const char *end) { return findByte(begin, end, '\n'); }
+
+        static Isa isa();            // 当前使用的实现
+        static Isa detectIsa();      // CPU支持的最优实现
+        static bool setIsa(Isa isa); // 指定实现(用于测试和基准), CPU不支持时返回 false
+    };
+} // namespace schwi
@@ -0,0 +1,159 @@
+#include "base/MonoTime.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define SCHWI_HAS_TSC 1
+#else
+#define SCHWI_HAS_TSC 0
+#endif
+
+namespace schwi
+{
+    namespace
+    {
+        const int64_t kCalibrateMicros = 50 * 1000; // 校准时长
+
+        int64_t clockMicros(clockid_t clock)
+        {
+            struct timespec ts;
+            ::clock_gettime(clock, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+        }
+
+        /**
+         * @brief TSC与单调时间的换算参数, 启用前写入, 之后只读
+         */
+        struct TscState
+        {
+            uint64_t baseCycles = 0;
+            int64_t baseMicros = 0;
+            double microsPerCycle = 0.0;
+        };
+
+        TscState g_tsc;
+        std::atomic_bool g_tscEnabled(false);
+
+#if SCHWI_HAS_TSC
+        /**
+         * @brief 同时读取TSC和单调时钟, 取两次rdtsc间隔最小的一次以减小误差
+         */
+        void readPair(uint64_t *cycles, int64_t *micros)
+        {
+            uint64_t best = UINT64_MAX;
+            for (int i = 0; i < 5; ++i)
+            {
+                uint64_t before = __rdtsc();
+                int64_t now = clockMicros(CLOCK_MONOTONIC);
+                uint64_t after = __rdtsc();
+                if (after - before < best)
+                {
+                    best = after - before;
+                    *cycles = before + (after - before) / 2;
+                    *micros = now;
+                }
+            }
+        }
+#endif
+
+        // 设置环境变量 TINY_NETWORK_USE_TSC 时在启动阶段完成校准
+        const bool g_tscFromEnv = ::getenv("TINY_NETWORK_USE_TSC") != nullptr && TscClock::enable();
+    } // namespace
+
+    MonoTime MonoTime::now()
+    {
+        if (g_tscEnabled.load(std::memory_order_acquire))
+        {
+            return TscClock::now();
+        }
+        return MonoTime(clockMicros(CLOCK_MONOTONIC));
+    }
+
+    Timestamp MonoTime::toTimestamp() const
+    {
+        int64_t offset = Timestamp::now().microseconds() - now().microseconds();
+        return Timestamp(_microseconds + offset);
+    }
+
+    MonoTime MonoTime::fromTimestamp(Timestamp time)
+    {
+        int64_t offset = Timestamp::now().microseconds() - now().microseconds();
+        return MonoTime(time.microseconds() - offset);
+    }
+
+    bool TscClock::available()
+    {
+#if SCHWI_HAS_TSC
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007)
+        {
+            return false;
+        }
+        __cpuid(0x80000007, eax, ebx, ecx, edx);
+        return (edx & (1u << 8)) != 0; // invariant TSC: 频率恒定且各核同步
+#else
+        return false;
+#endif
+    }
+
+    bool TscClock::enable()
+    {
+#if SCHWI_HAS_TSC
+        if (!available())
+        {
+            return false;
+        }
+
+        g_tscEnabled.store(false, std::memory_order_release);
+
+        uint64_t startCycles, endCycles;
+        int64_t startMicros, endMicros;
+        readPair(&startCycles, &startMicros);
+        do
+        {
+            readPair(&endCycles, &endMicros);
+        } while (endMicros - startMicros < kCalibrateMicros);
+
+        g_tsc.baseCycles = endCycles;
+        g_tsc.baseMicros = endMicros;
+        g_tsc.microsPerCycle = static_cast<double>(endMicros - startMicros) / static_cast<double>(endCycles - startCycles);
+        g_tscEnabled.store(true, std::memory_order_release);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void TscClock::disable()
+    {
+        g_tscEnabled.store(false, std::memory_order_release);
+    }
+
+    bool TscClock::enabled()
+    {
+        return g_tscEnabled.load(std::memory_order_acquire);
+    }
+
+    MonoTime TscClock::now()
+    {
+#if SCHWI_HAS_TSC
+        if (g_tsc.microsPerCycle <= 0.0)
+        {
+            return MonoTime(clockMicros(CLOCK_MONOTONIC));
+        }
+        int64_t cycles = static_cast<int64_t>(__rdtsc() - g_tsc.baseCycles);
+        return MonoTime(g_tsc.baseMicros + static_cast<int64_t>(static_cast<double>(cycles) * g_tsc.microsPerCycle));
+#else
+        return MonoTime(clockMicros(CLOCK_MONOTONIC));
+#endif
+    }
+
+    double TscClock::cyclesPerMicrosecond()
+    {
+        return g_tsc.microsPerCycle > 0.0 ? 1.0 / g_tsc.microsPerCycle : 0.0;
+    }
+} // namespace schwi
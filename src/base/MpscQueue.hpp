@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+
+#include "base/noncopyable.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 侵入式MPSC队列的节点, 元素类型需要继承该结构
+     */
+    struct MpscQueueNode
+    {
+        std::atomic<MpscQueueNode *> _next{nullptr};
+    };
+
+    /**
+     * @brief 侵入式无锁多生产者单消费者队列 (Vyukov)
+     *
+     * push 可由任意线程调用, 只需一次原子交换; pop/consume 只能由唯一的消费者线程调用。
+     * 队列不负责节点的内存管理。
+     */
+    template <typename T>
+    class MpscQueue : noncopyable
+    {
+    public:
+        MpscQueue()
+            : _head(&_stub),
+              _tail(&_stub)
+        {
+        }
+
+        /**
+         * @brief 入队, 多线程安全
+         */
+        void push(T *node)
+        {
+            push(static_cast<MpscQueueNode *>(node));
+        }
+
+        /**
+         * @brief 出队, 只能由消费者线程调用
+         * @return 队列为空或有生产者尚未完成入队时返回 nullptr
+         */
+        T *pop()
+        {
+            MpscQueueNode *tail = _tail;
+            MpscQueueNode *next = tail->_next.load(std::memory_order_acquire);
+            if (tail == &_stub)
+            {
+                if (next == nullptr)
+                {
+                    return nullptr;
+                }
+                _tail = next;
+                tail = next;
+                next = next->_next.load(std::memory_order_acquire);
+            }
+
+            if (next != nullptr)
+            {
+                _tail = next;
+                return static_cast<T *>(tail);
+            }
+
+            if (tail != _head.load(std::memory_order_acquire))
+            {
+                return nullptr;
+            }
+
+            push(&_stub);
+            next = tail->_next.load(std::memory_order_acquire);
+            if (next != nullptr)
+            {
+                _tail = next;
+                return static_cast<T *>(tail);
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief 取出调用时刻之前入队的所有节点, 之后入队的节点留到下一次处理
+         *
+         * _head 为 _stub 时不能据此判空: pop 会把 _stub 重新入队, 它之前可能还挂着
+         * 未取出的节点。此时快照点不会被 pop 返回, 一直取到 pop 返回空为止。
+         * pop 遇到正在入队的生产者也会返回空, 剩余节点由该生产者入队后的唤醒处理。
+         * @param func 对每个节点调用, 可以在其中释放节点
+         * @return 处理的节点数
+         */
+        template <typename Func>
+        size_t consume(Func &&func)
+        {
+            size_t count = 0;
+            MpscQueueNode *last = _head.load(std::memory_order_acquire);
+            while (T *node = pop())
+            {
+                bool done = static_cast<MpscQueueNode *>(node) == last;
+                func(node);
+                ++count;
+                if (done)
+                {
+                    break;
+                }
+            }
+            return count;
+        }
+
+        /**
+         * @brief 队列是否为空, 只能由消费者线程调用
+         */
+        bool empty() const
+        {
+            return _tail == &_stub && _tail->_next.load(std::memory_order_acquire) == nullptr;
+        }
+
+    private:
+        void push(MpscQueueNode *node)
+        {
+            node->_next.store(nullptr, std::memory_order_relaxed);
+            MpscQueueNode *prev = _head.exchange(node, std::memory_order_acq_rel);
+            prev->_next.store(node, std::memory_order_release);
+        }
+
+        alignas(64) std::atomic<MpscQueueNode *> _head; // 生产者端
+        alignas(64) MpscQueueNode *_tail;               // 消费者端
+        MpscQueueNode _stub;
+    }; // class MpscQueue
+} // namespace schwi
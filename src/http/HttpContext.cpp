@@ -48,6 +48,21 @@ namespace schwi
         return succeed;
     }
 
+    const char *HttpContext::findCRLF(const Buffer *buf)
+    {
+        const char *crlf = buf->findCRLF(buf->peek() + _scanned);
+        if (crlf != nullptr)
+        {
+            _scanned = 0;
+        }
+        else if (buf->readableBytes() > 0)
+        {
+            // 记住已检查过的位置, 末尾的'\r'可能和之后到达的'\n'组成CRLF, 需要保留
+            _scanned = buf->readableBytes() - 1;
+        }
+        return crlf;
+    }
+
     bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime)
     {
         bool ok = true;
@@ -56,7 +71,7 @@ namespace schwi
         {
             if (_state == kExpectRequestLine)
             {
-                const char *crlf = buf->findCRLF();
+                const char *crlf = findCRLF(buf);
                 if (crlf)
                 {
                     ok = processRequestLine(buf->peek(), crlf);
@@ -78,10 +93,10 @@ namespace schwi
             }
             else if (_state == kExpectHeaders)
             {
-                const char *crlf = buf->findCRLF();
+                const char *crlf = findCRLF(buf);
                 if (crlf)
                 {
-                    const char *colon = std::find(buf->peek(), crlf, ':');
+                    const char *colon = ByteSearch::findByte(buf->peek(), crlf, ':');
                     if (colon != crlf)
                     {
                         _request.addHeader(buf->peek(), colon, crlf);
@@ -18,10 +18,12 @@ namespace schwi
         };
 
         HttpContext()
-            : _state(kExpectRequestLine)
+            : _state(kExpectRequestLine),
+              _scanned(0)
         {
         }
 
+        // 增量解析, 两次调用之间除本函数外不能从buf中取走数据
         bool parseRequest(Buffer *buf, Timestamp receiveTime);
 
         bool gotAll() const { return _state == kGotAll; }
@@ -29,6 +31,7 @@ namespace schwi
         void reset()
         {
             _state = kExpectRequestLine;
+            _scanned = 0;
             HttpRequest dummy;
             _request.swap(dummy);
         }
@@ -39,8 +42,10 @@ namespace schwi
 
     private:
         bool processRequestLine(const char *begin, const char *end);
+        const char *findCRLF(const Buffer *buf);
 
         HttpRequestParseState _state;
+        size_t _scanned; // 可读区域开头已确认不含CRLF的字节数
         HttpRequest _request;
     };
 } // namespace schwi
@@ -1,18 +1,18 @@
 #include "http/HttpResponse.hpp"
 #include "net/Buffer.hpp"
 
-#include <stdio.h>
-#include <string.h>
-
 namespace schwi
 {
     void HttpResponse::appendToBuffer(Buffer *output) const
     {
-        char buf[32];
-        snprintf(buf, sizeof buf, "HTTP/1.1 %d ", _statusCode);
-        output->append(buf);
-        output->append(_statusMessage);
-        output->append("\r\n");
+        appendHeadToBuffer(output);
+        output->append(_body);
+    }
+
+    void HttpResponse::appendHeadToBuffer(Buffer *output) const
+    {
+        // 状态行和数字字段直接格式化进输出缓冲区
+        output->appendFormat("HTTP/1.1 {} {}\r\n", static_cast<int>(_statusCode), _statusMessage);
 
         if (_closeConnection)
         {
@@ -20,20 +20,14 @@ namespace schwi
         }
         else
         {
-            snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", _body.size());
-            output->append(buf);
-            output->append("Connection: Keep-Alive\r\n");
+            output->appendFormat("Content-Length: {}\r\nConnection: Keep-Alive\r\n", _body.size());
         }
 
         for (const auto &header : _headers)
         {
-            output->append(header.first);
-            output->append(": ");
-            output->append(header.second);
-            output->append("\r\n");
+            output->appendFormat("{}: {}\r\n", header.first, header.second);
         }
 
         output->append("\r\n");
-        output->append(_body);
     }
 } // namespace schwi
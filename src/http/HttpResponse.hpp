@@ -59,7 +59,13 @@ namespace schwi
             _body = body;
         }
 
+        const std::string &body() const
+        {
+            return _body;
+        }
+
         void appendToBuffer(Buffer *output) const;
+        void appendHeadToBuffer(Buffer *output) const; // 只写状态行和头部, 不包括body
 
     private:
         std::unordered_map<std::string, std::string> _headers;
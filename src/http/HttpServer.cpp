@@ -83,9 +83,13 @@ namespace schwi
                   close ? "close" : "keep-alive");
         HttpResponse response(close);
         _httpCallback(req, &response);
-        Buffer buf;
-        response.appendToBuffer(&buf);
-        conn->send(&buf);
+        // 头部和body分两段 writev 发送, body 不再拷贝进头部的缓冲区
+        Buffer head;
+        response.appendHeadToBuffer(&head);
+        const iovec message[] = {
+            {const_cast<char *>(head.peek()), head.readableBytes()},
+            {const_cast<char *>(response.body().data()), response.body().size()}};
+        conn->send(message);
         if (response.closeConnection())
         {
             conn->shutdown();
@@ -1,6 +1,35 @@
 #include "log/Logger.hpp"
 #include "base/CurrentThread.hpp"
 
+#include <fmt/chrono.h>
+
 namespace schwi
 {
+    namespace
+    {
+        const size_t kSecondPrefixLen = 19; // "YYYY-MM-DD HH:MM:SS"
+        const size_t kTimeLen = kSecondPrefixLen + 7;
+
+        thread_local char t_time[kTimeLen + 1];
+        thread_local time_t t_lastSecond = -1;
+    } // namespace
+
+    std::string_view Logger::formatTime(Timestamp time)
+    {
+        time_t seconds = time.seconds();
+        if (seconds != t_lastSecond)
+        {
+            fmt::format_to_n(t_time, kSecondPrefixLen, "{:%Y-%m-%d %H:%M:%S}", fmt::localtime(seconds));
+            t_time[kSecondPrefixLen] = '.';
+            t_lastSecond = seconds;
+        }
+
+        int micros = static_cast<int>(time.microseconds() % Timestamp::kMicroSecondsPerSecond);
+        for (size_t i = kTimeLen - 1; i > kSecondPrefixLen; --i)
+        {
+            t_time[i] = static_cast<char>('0' + micros % 10);
+            micros /= 10;
+        }
+        return std::string_view(t_time, kTimeLen);
+    }
 }
\ No newline at end of file
@@ -119,6 +119,14 @@ namespace schwi
             log_(file, line, level, "{}", msg);
         }
 
+        /**
+         * @brief 格式化日志时间 "YYYY-MM-DD HH:MM:SS.uuuuuu"
+         *
+         * 线程局部缓存到秒为止的前缀, 秒数不变时只改写微秒部分, 避免每行都做时区转换和完整格式化
+         * @return 指向线程局部缓冲区, 在本线程下一次调用前有效
+         */
+        static std::string_view formatTime(Timestamp time);
+
         /**
          * @brief 记录日志
          *
@@ -247,7 +255,8 @@ namespace schwi
         auto format_arg_pointer(T &&arg)
         {
             if constexpr (std::is_pointer_v<std::remove_reference_t<T>> &&
-                          !std::is_same_v<std::remove_reference_t<T>, const char *>)
+                          !std::is_same_v<std::remove_cv_t<std::remove_reference_t<T>>, const char *> &&
+                          !std::is_same_v<std::remove_cv_t<std::remove_reference_t<T>>, char *>)
             {
                 return fmt::ptr(arg);
             }
@@ -280,7 +289,7 @@ namespace schwi
             std::string prefixStr = fmt::format(
                 "[{}] [{} {}:{}] ",
                 getLevelName[level],
-                Timestamp::now().toString(),
+                formatTime(Timestamp::now()),
                 FileUtil::getFileName(file),
                 line);
             std::string logMessage = prefixStr + message + "\n";
@@ -309,7 +318,7 @@ namespace schwi
             std::string prefixStr = fmt::format(
                 "[{}] [{} {}:{}] ",
                 getLevelName[level],
-                Timestamp::now().toString(),
+                formatTime(Timestamp::now()),
                 FileUtil::getFileName(file),
                 line);
             std::string logMessage = prefixStr + std::string(msg) + "\n";
@@ -1,6 +1,7 @@
 #include "net/Acceptor.hpp"
 #include "base/base.hpp"
 #include "net/InetAddress.hpp"
+#include "net/EventLoop.hpp"
 
 #include <functional>
 #include <unistd.h>
@@ -10,6 +11,8 @@
 
 namespace schwi
 {
+    const int kMaxAcceptsPerEvent = 64; // 边沿触发时单次事件最多accept的连接数
+
     static int createNonblocking()
     {
         int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
@@ -48,27 +51,46 @@ namespace schwi
 
     void Acceptor::handleRead()
     {
-        InetAddress peerAddr(0);
-        int connfd = _acceptSocket.accept(&peerAddr);
-        if (connfd >= 0)
+        // 边沿触发时需要accept到EAGAIN为止, 单次事件最多接受kMaxAcceptsPerEvent个连接
+        const int maxAccepts = _acceptChannel.edgeTriggered() ? kMaxAcceptsPerEvent : 1;
+        for (int i = 0; i < maxAccepts; ++i)
         {
-            if (_newConnectionCallback)
+            InetAddress peerAddr(0);
+            int connfd = _acceptSocket.accept(&peerAddr);
+            if (connfd >= 0)
             {
-                _newConnectionCallback(connfd, peerAddr);
+                if (_newConnectionCallback)
+                {
+                    _newConnectionCallback(connfd, peerAddr);
+                }
+                else
+                {
+                    LOG_ERROR("no newConnectionCallback() in Acceptor::handleRead");
+                    ::close(connfd);
+                }
             }
             else
             {
-                LOG_ERROR("no newConnectionCallback() in Acceptor::handleRead");
-                ::close(connfd);
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    LOG_ERROR("accept() failed in Acceptor::handleRead");
+                    if (errno == EMFILE || errno == ENFILE)
+                    {
+                        LOG_ERROR("EMFILE error");
+                        if (_fdExhaustedCallback)
+                        {
+                            _fdExhaustedCallback();
+                        }
+                    }
+                }
+                return;
             }
         }
-        else
+
+        if (_acceptChannel.edgeTriggered())
         {
-            LOG_ERROR("accept() failed in Acceptor::handleRead");
-            if (errno == EMFILE)
-            {
-                LOG_ERROR("EMFILE error");
-            }
+            // 达到上限时可能还有未accept的连接, 留到本轮末尾继续
+            _loop->queueInLoop(std::bind(&Acceptor::handleRead, this));
         }
     }
 } // namespace schwi
@@ -13,6 +13,7 @@ namespace schwi
     {
     public:
         using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &)>;
+        using FdExhaustedCallback = std::function<void()>;
 
         Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
         ~Acceptor();
@@ -22,9 +23,15 @@ namespace schwi
             _newConnectionCallback = cb;
         }
 
+        // accept 因fd耗尽(EMFILE/ENFILE)失败时回调, 可以关闭一些连接腾出fd
+        void setFdExhaustedCallback(const FdExhaustedCallback &cb) { _fdExhaustedCallback = cb; }
+
         bool listenning() const { return _listenning; }
         void listen();
 
+        // 以边沿触发方式监听, 需要在listen之前调用
+        void setEdgeTriggered(bool on) { _acceptChannel.setEdgeTriggered(on); }
+
     private:
         void handleRead();
 
@@ -32,6 +39,7 @@ namespace schwi
         Socket _acceptSocket;
         Channel _acceptChannel;
         NewConnectionCallback _newConnectionCallback;
+        FdExhaustedCallback _fdExhaustedCallback;
         bool _listenning;
     };
 } // namespace schwi
@@ -1,17 +1,203 @@
 #include "net/Buffer.hpp"
+#include "net/BufferPool.hpp"
+#include "net/ReadSizePredictor.hpp"
 #include "base/base.hpp"
 
 #include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
 namespace schwi
 {
-    const char Buffer::kCRLF[] = "\r\n";
 
-    ssize_t Buffer::readFd(int fd, int *savedErrno)
+    // 未使用内存池的缓冲区共用的临时读缓冲, 每个线程第一次使用时分配
+    thread_local std::unique_ptr<char[]> t_scratch;
+    char Buffer::kEmpty[Buffer::kCheapPrepend];
+
+    Buffer::Buffer(size_t initialSize)
+        : _data(nullptr),
+          _capacity(0),
+          _pool(nullptr),
+          _readerIndex(kCheapPrepend),
+          _writerIndex(kCheapPrepend),
+          _chained(false),
+          _chainBytes(0)
+    {
+        reallocate(kCheapPrepend + initialSize);
+    }
+
+    Buffer::Buffer(BufferPool *pool)
+        : _data(nullptr),
+          _capacity(0),
+          _pool(pool),
+          _readerIndex(kCheapPrepend),
+          _writerIndex(kCheapPrepend),
+          _chained(false),
+          _chainBytes(0)
+    {
+    }
+
+    Buffer::~Buffer()
+    {
+        releaseStorage();
+    }
+
+    Buffer::Buffer(const Buffer &other)
+        : _data(nullptr),
+          _capacity(0),
+          _pool(nullptr),
+          _readerIndex(kCheapPrepend),
+          _writerIndex(kCheapPrepend),
+          _chained(other._chained),
+          _segments(other._segments),
+          _chainBytes(other._chainBytes)
+    {
+        if (!_chained)
+        {
+            append(other.peek(), other.readableBytes());
+        }
+    }
+
+    Buffer::Buffer(Buffer &&other) noexcept
+        : _data(other._data),
+          _capacity(other._capacity),
+          _pool(other._pool),
+          _readerIndex(other._readerIndex),
+          _writerIndex(other._writerIndex),
+          _chained(other._chained),
+          _segments(std::move(other._segments)),
+          _chainBytes(other._chainBytes)
     {
-        char extrabuf[65536] = {0};
+        other._data = nullptr;
+        other._capacity = 0;
+        other._readerIndex = kCheapPrepend;
+        other._writerIndex = kCheapPrepend;
+        other._segments.clear();
+        other._chainBytes = 0;
+    }
+
+    Buffer &Buffer::operator=(const Buffer &other)
+    {
+        if (this != &other)
+        {
+            Buffer copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    Buffer &Buffer::operator=(Buffer &&other) noexcept
+    {
+        if (this != &other)
+        {
+            releaseStorage();
+            std::swap(_data, other._data);
+            std::swap(_capacity, other._capacity);
+            _pool = other._pool;
+            _readerIndex = other._readerIndex;
+            _writerIndex = other._writerIndex;
+            _chained = other._chained;
+            _segments = std::move(other._segments);
+            _chainBytes = other._chainBytes;
+            other._readerIndex = kCheapPrepend;
+            other._writerIndex = kCheapPrepend;
+            other._segments.clear();
+            other._chainBytes = 0;
+        }
+        return *this;
+    }
+
+    void Buffer::detachPool()
+    {
+        if (_pool == nullptr)
+        {
+            return;
+        }
+        if (_chained && _data != nullptr)
+        {
+            // 链式模式下连续内存没有数据, 直接还给内存池
+            _pool->deallocate(_data, _capacity);
+            _data = nullptr;
+            _capacity = 0;
+            _readerIndex = kCheapPrepend;
+            _writerIndex = kCheapPrepend;
+        }
+        else if (_data != nullptr)
+        {
+            _pool->release(_capacity);
+        }
+        _pool = nullptr;
+    }
+
+    void Buffer::setPool(BufferPool *pool)
+    {
+        if (pool == _pool)
+        {
+            return;
+        }
+
+        size_t readable = _chained ? 0 : readableBytes();
+        char *oldData = _data;
+        size_t oldCapacity = _capacity;
+        BufferPool *oldPool = _pool;
+
+        _data = nullptr;
+        _capacity = 0;
+        _pool = pool;
+        if (readable > 0)
+        {
+            reallocate(kCheapPrepend + readable);
+            ::memcpy(_data + kCheapPrepend, oldData + _readerIndex, readable);
+        }
+        _readerIndex = kCheapPrepend;
+        _writerIndex = kCheapPrepend + readable;
+
+        if (oldData != nullptr && oldPool != nullptr)
+        {
+            oldPool->deallocate(oldData, oldCapacity);
+        }
+        else if (oldData != nullptr)
+        {
+            ::free(oldData);
+        }
+    }
+
+    ssize_t Buffer::readFd(int fd, int *savedErrno, ReadSizePredictor *predictor)
+    {
+        const size_t extraSize = BufferPool::kScratchSize;
+        if (_pool == nullptr && !t_scratch)
+        {
+            t_scratch.reset(new char[extraSize]);
+        }
+        char *extrabuf = _pool != nullptr ? _pool->scratch() : t_scratch.get();
+
+        if (_chained)
+        {
+            // 链式模式读入临时缓冲后追加到分段中
+            const ssize_t n = ::read(fd, extrabuf, extraSize);
+            if (n < 0)
+            {
+                *savedErrno = errno;
+            }
+            else
+            {
+                appendChain(extrabuf, n);
+            }
+            if (n > 0 && predictor != nullptr)
+            {
+                predictor->record(n);
+            }
+            return n;
+        }
+
+        if (predictor != nullptr)
+        {
+            // 预测值按整块内存计算, 扣除预留区后正好落在内存池的大小等级上
+            ensureWritableBytes(predictor->nextReadSize() - kCheapPrepend);
+        }
 
         struct iovec vec[2];
         const size_t writable = writableBytes();
@@ -19,7 +205,7 @@ namespace schwi
         vec[0].iov_base = begin() + _writerIndex;
         vec[0].iov_len = writable;
         vec[1].iov_base = extrabuf;
-        vec[1].iov_len = sizeof(extrabuf);
+        vec[1].iov_len = extraSize;
 
         const ssize_t n = ::readv(fd, vec, 2);
         if (n < 0)
@@ -32,15 +218,30 @@ namespace schwi
         }
         else
         {
-            _writerIndex = _buffer.size();
+            _writerIndex += writable;
             append(extrabuf, n - writable);
         }
+
+        if (n > 0 && predictor != nullptr)
+        {
+            predictor->record(n);
+        }
+        else if (n <= 0 && readableBytes() == 0 && _pool != nullptr)
+        {
+            // 预留的空间没有用上(EAGAIN或对端关闭), 立即还给池
+            releaseStorage();
+        }
         return n;
     }
 
-    ssize_t Buffer::writeFd(int fd, int *savedErrno)
+    ssize_t Buffer::writeFd(int fd, int *savedErrno, size_t maxBytes)
     {
-        ssize_t n = ::write(fd, peek(), readableBytes());
+        if (_chained)
+        {
+            return writeChain(fd, savedErrno, maxBytes);
+        }
+
+        ssize_t n = ::write(fd, peek(), std::min(readableBytes(), maxBytes));
         if (n < 0)
         {
             *savedErrno = errno;
@@ -48,18 +249,359 @@ namespace schwi
         return n;
     }
 
+    char *Buffer::reserve(size_t len)
+    {
+        if (!_chained)
+        {
+            ensureWritableBytes(len);
+            return beginWrite();
+        }
+        if (writableSpace() < len)
+        {
+            size_t capacity = len > kSlabSize ? len : kSlabSize;
+            std::shared_ptr<char[]> slab(new char[capacity]);
+            _segments.push_back(Segment{slab, slab.get(), 0, 0, capacity});
+        }
+        Segment &tail = _segments.back();
+        return const_cast<char *>(tail.data) + tail.end;
+    }
+
+    void Buffer::prepend(const void *data, size_t len)
+    {
+        if (_chained)
+        {
+            std::shared_ptr<char[]> header(new char[len]);
+            ::memcpy(header.get(), data, len);
+            _segments.push_front(Segment{header, header.get(), 0, len, len});
+            _chainBytes += len;
+            return;
+        }
+        if (_data == nullptr)
+        {
+            // 借用池内存的空缓冲区还没有预留区, 先分配
+            makeSpace(0);
+        }
+        if (len > prependableBytes())
+        {
+            makeFrontSpace(len);
+        }
+        _readerIndex -= len;
+        ::memcpy(begin() + _readerIndex, data, len);
+    }
+
+    size_t Buffer::writableSpace() const
+    {
+        if (!_chained)
+        {
+            return writableBytes();
+        }
+        // 与 appendChain 一致, 只有独占的库内分段可以继续写入
+        if (_segments.empty() || _segments.back().owner.use_count() != 1)
+        {
+            return 0;
+        }
+        return _segments.back().capacity - _segments.back().end;
+    }
+
     void Buffer::makeSpace(size_t len)
     {
-        if (writableBytes() + prependableBytes() < len + kCheapPrepend)
+        size_t readable = readableBytes();
+        if (_data == nullptr || writableBytes() + prependableBytes() < len + kCheapPrepend)
         {
-            _buffer.resize(_writerIndex + len);
+            // 按倍数增长, 新内存不做零初始化
+            char *oldData = _data;
+            size_t oldCapacity = _capacity;
+            BufferPool *pool = _pool;
+            _data = nullptr;
+            reallocate(std::max(kCheapPrepend + readable + len, 2 * oldCapacity));
+            if (readable > 0)
+            {
+                ::memcpy(_data + kCheapPrepend, oldData + _readerIndex, readable);
+            }
+            releaseData(oldData, oldCapacity, pool);
         }
         else
         {
-            size_t readable = readableBytes();
             std::copy(begin() + _readerIndex, begin() + _writerIndex, begin() + kCheapPrepend);
-            _readerIndex = kCheapPrepend;
-            _writerIndex = _readerIndex + readable;
         }
+        _readerIndex = kCheapPrepend;
+        _writerIndex = _readerIndex + readable;
+    }
+
+    /**
+     * @brief 预留区不足 len 时把可读数据后移(必要时重新分配), 补写后仍保留 kCheapPrepend 的预留区
+     */
+    void Buffer::makeFrontSpace(size_t len)
+    {
+        size_t readable = readableBytes();
+        size_t front = kCheapPrepend + len;
+        if (_capacity < front + readable)
+        {
+            char *oldData = _data;
+            size_t oldCapacity = _capacity;
+            BufferPool *pool = _pool;
+            _data = nullptr;
+            reallocate(std::max(front + readable, 2 * oldCapacity));
+            if (readable > 0)
+            {
+                ::memcpy(_data + front, oldData + _readerIndex, readable);
+            }
+            releaseData(oldData, oldCapacity, pool);
+        }
+        else
+        {
+            // 数据向后移动, 区间可能重叠
+            std::copy_backward(begin() + _readerIndex, begin() + _writerIndex, begin() + front + readable);
+        }
+        _readerIndex = front;
+        _writerIndex = front + readable;
+    }
+
+    void Buffer::reallocate(size_t size)
+    {
+        if (_pool != nullptr)
+        {
+            _data = _pool->allocate(size, &_capacity);
+        }
+        else
+        {
+            _data = static_cast<char *>(::malloc(size));
+            _capacity = size;
+        }
+    }
+
+    void Buffer::releaseData(char *data, size_t capacity, BufferPool *pool)
+    {
+        if (data != nullptr && pool != nullptr)
+        {
+            pool->deallocate(data, capacity);
+        }
+        else if (data != nullptr)
+        {
+            ::free(data);
+        }
+    }
+
+    void Buffer::releaseStorage()
+    {
+        if (_data == nullptr)
+        {
+            return;
+        }
+        if (_pool != nullptr)
+        {
+            _pool->deallocate(_data, _capacity);
+        }
+        else
+        {
+            ::free(_data);
+        }
+        _data = nullptr;
+        _capacity = 0;
+    }
+
+    void Buffer::setChained(bool on)
+    {
+        if (readableBytes() != 0)
+        {
+            LOG_ERROR("Buffer::setChained() buffer is not empty");
+            return;
+        }
+        retrieveAll();
+        _chained = on;
+    }
+
+    void Buffer::append(std::string &&str)
+    {
+        if (!_chained || str.size() < kMinOwnedAppend)
+        {
+            append(str.data(), str.size());
+            return;
+        }
+        auto owner = std::make_shared<const std::string>(std::move(str));
+        appendSegment(owner, owner->data(), owner->size());
+    }
+
+    void Buffer::append(std::shared_ptr<const char[]> data, size_t len)
+    {
+        if (!_chained || len < kMinOwnedAppend)
+        {
+            append(data.get(), len);
+            return;
+        }
+        const char *ptr = data.get();
+        appendSegment(std::move(data), ptr, len);
+    }
+
+    void Buffer::append(std::shared_ptr<const void> owner, const char *data, size_t len)
+    {
+        if (!_chained || owner == nullptr || len < kMinOwnedAppend)
+        {
+            append(data, len);
+            return;
+        }
+        appendSegment(std::move(owner), data, len);
+    }
+
+    void Buffer::appendChain(const char *data, size_t len)
+    {
+        while (len > 0)
+        {
+            // 只有独占的库内分段才能继续写入, 共享出去的分段保持只读
+            if (_segments.empty() ||
+                _segments.back().capacity == _segments.back().end ||
+                _segments.back().owner.use_count() != 1)
+            {
+                size_t capacity = len > kSlabSize ? len : kSlabSize;
+                std::shared_ptr<char[]> slab(new char[capacity]);
+                _segments.push_back(Segment{slab, slab.get(), 0, 0, capacity});
+            }
+
+            Segment &tail = _segments.back();
+            size_t n = std::min(len, tail.capacity - tail.end);
+            ::memcpy(const_cast<char *>(tail.data) + tail.end, data, n);
+            tail.end += n;
+            _chainBytes += n;
+            data += n;
+            len -= n;
+        }
+    }
+
+    void Buffer::append(Buffer &&other)
+    {
+        if (_chained && other._chained)
+        {
+            for (Segment &segment : other._segments)
+            {
+                if (segment.end > segment.begin)
+                {
+                    _segments.push_back(std::move(segment));
+                }
+            }
+            _chainBytes += other._chainBytes;
+            other._segments.clear();
+            other._chainBytes = 0;
+            return;
+        }
+
+        if (other._chained)
+        {
+            for (const Segment &segment : other._segments)
+            {
+                append(segment.data + segment.begin, segment.end - segment.begin);
+            }
+        }
+        else
+        {
+            append(other.peek(), other.readableBytes());
+        }
+        other.retrieveAll();
+    }
+
+    std::shared_ptr<const void> Buffer::frontSegment(const char **data, size_t *len) const
+    {
+        if (!_chained || _segments.empty())
+        {
+            *data = peek();
+            *len = _chained ? 0 : readableBytes();
+            return nullptr;
+        }
+        const Segment &front = _segments.front();
+        *data = front.data + front.begin;
+        *len = front.end - front.begin;
+        return front.owner;
+    }
+
+    void Buffer::appendSegment(std::shared_ptr<const void> owner, const char *data, size_t len)
+    {
+        if (len == 0)
+        {
+            return;
+        }
+        _segments.push_back(Segment{std::move(owner), data, 0, len, len});
+        _chainBytes += len;
+    }
+
+    void Buffer::retrieveChain(size_t len)
+    {
+        if (len >= _chainBytes)
+        {
+            retrieveAll();
+            return;
+        }
+
+        _chainBytes -= len;
+        while (len > 0)
+        {
+            Segment &front = _segments.front();
+            size_t n = std::min(len, front.end - front.begin);
+            front.begin += n;
+            len -= n;
+            if (front.begin == front.end)
+            {
+                _segments.pop_front();
+            }
+        }
+    }
+
+    std::string Buffer::copyChain(size_t len) const
+    {
+        std::string result;
+        result.reserve(std::min(len, _chainBytes));
+        for (const Segment &segment : _segments)
+        {
+            if (result.size() == len)
+            {
+                break;
+            }
+            size_t n = std::min(len - result.size(), segment.end - segment.begin);
+            result.append(segment.data + segment.begin, n);
+        }
+        return result;
+    }
+
+    size_t Buffer::peekSegments(struct iovec *iov, size_t maxCount, size_t maxBytes) const
+    {
+        if (!_chained)
+        {
+            if (maxCount == 0 || maxBytes == 0 || readableBytes() == 0)
+            {
+                return 0;
+            }
+            iov[0].iov_base = const_cast<char *>(peek());
+            iov[0].iov_len = std::min(readableBytes(), maxBytes);
+            return 1;
+        }
+
+        size_t count = 0;
+        for (const Segment &segment : _segments)
+        {
+            if (count == maxCount || maxBytes == 0)
+            {
+                break;
+            }
+            if (segment.end == segment.begin)
+            {
+                continue;
+            }
+            iov[count].iov_base = const_cast<char *>(segment.data + segment.begin);
+            iov[count].iov_len = std::min(segment.end - segment.begin, maxBytes);
+            maxBytes -= iov[count].iov_len;
+            ++count;
+        }
+        return count;
+    }
+
+    ssize_t Buffer::writeChain(int fd, int *savedErrno, size_t maxBytes)
+    {
+        struct iovec vec[IOV_MAX];
+        const int count = static_cast<int>(peekSegments(vec, IOV_MAX, maxBytes));
+
+        ssize_t n = ::writev(fd, vec, count);
+        if (n < 0)
+        {
+            *savedErrno = errno;
+        }
+        return n;
     }
 } // namespace schwi
\ No newline at end of file
@@ -1,33 +1,83 @@
 #pragma once
 
-#include <vector>
+#include <deque>
 #include <string>
+#include <memory>
 #include <algorithm>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <fmt/format.h>
+
+#include "base/ByteSearch.hpp"
 
 namespace schwi
 {
+    class BufferPool;
+    class ReadSizePredictor;
+
+    /**
+     * @brief 网络收发缓冲区
+     *
+     * 默认为连续内存; 链式模式下数据保存在一串引用计数的分段中, 追加外部内存时只持有引用不拷贝,
+     * 写出时用一次 writev 发送多个分段, 适合作为大块数据的输出缓冲。
+     * 链式模式只支持按字节数操作的接口(readableBytes/retrieve/append/readFd/writeFd 等),
+     * peek/findCRLF 等需要连续内存的接口只能用于默认模式。
+     * 指定 BufferPool 时连续内存向池借用: 初始不占内存, 读空后立即归还, 适合大量空闲连接。
+     * 序列化时可用 reserve/commit 或 appendFormat 直接写入缓冲区, 用 prepend 在数据前补写长度等头部。
+     */
     class Buffer
     {
     public:
+        using value_type = char; // 支持 std::back_inserter
+
         static const size_t kCheapPrepend = 8;
         static const size_t kInitialSize = 1024;
+        static const size_t kSlabSize = 16 * 1024;  // 链式模式下库内分配的分段大小
+        static const size_t kMinOwnedAppend = 256; // 小于该长度的外部内存直接拷贝, 不单独成段
 
-        explicit Buffer(size_t initialSize = kInitialSize)
-            : _buffer(kCheapPrepend + initialSize),
-              _readerIndex(kCheapPrepend),
-              _writerIndex(kCheapPrepend)
-        {
-        }
+        explicit Buffer(size_t initialSize = kInitialSize);
+        explicit Buffer(BufferPool *pool); // 使用loop的内存池, 只能在该loop线程中使用
+        ~Buffer();
+
+        Buffer(const Buffer &other); // 拷贝不共享内存池
+        Buffer(Buffer &&other) noexcept;
+        Buffer &operator=(const Buffer &other);
+        Buffer &operator=(Buffer &&other) noexcept;
 
-        size_t readableBytes() const { return _writerIndex - _readerIndex; }
-        size_t writableBytes() const { return _buffer.size() - _writerIndex; }
+        /**
+         * @brief 更换内存池, 未读数据会迁移到新的内存中; 传入 nullptr 表示改为独立分配
+         */
+        void setPool(BufferPool *pool);
+        BufferPool *pool() const { return _pool; }
+
+        /**
+         * @brief 与内存池脱离但不拷贝数据: 当前内存改为独立分配, 之后可以移动到其他线程, 需要在内存池所属线程调用
+         */
+        void detachPool();
+        size_t capacity() const { return _capacity; } // 连续内存的大小, 包括预留区
+
+        /**
+         * @brief 切换链式模式, 只能在缓冲区为空时调用
+         */
+        void setChained(bool on);
+        bool chained() const { return _chained; }
+        size_t segmentCount() const { return _chained ? _segments.size() : 1; } // 待发送的分段数
+
+        size_t readableBytes() const { return _chained ? _chainBytes : _writerIndex - _readerIndex; }
+        size_t writableBytes() const { return _capacity > _writerIndex ? _capacity - _writerIndex : 0; }
         size_t prependableBytes() const { return _readerIndex; }
 
         const char *peek() const { return begin() + _readerIndex; }
         void retrieveUntil(const char *end) { retrieve(end - peek()); }
         void retrieve(size_t len)
         {
-            if (len < readableBytes())
+            if (_chained)
+            {
+                retrieveChain(len);
+            }
+            else if (len < readableBytes())
             {
                 _readerIndex += len;
             }
@@ -41,11 +91,18 @@ namespace schwi
         {
             _readerIndex = kCheapPrepend;
             _writerIndex = kCheapPrepend;
+            _segments.clear();
+            _chainBytes = 0;
+            if (_pool != nullptr && _data != nullptr)
+            {
+                // 读空后把内存还给池, 空闲连接不占用缓冲区
+                releaseStorage();
+            }
         }
 
         std::string retrieveAsString(size_t len)
         {
-            std::string result(peek(), len);
+            std::string result = _chained ? copyChain(len) : std::string(peek(), len);
             retrieve(len);
             return result;
         }
@@ -58,7 +115,7 @@ namespace schwi
         std::string GetBufferAllAsString()
         {
             size_t len = readableBytes();
-            std::string str(peek(), len);
+            std::string str = _chained ? copyChain(len) : std::string(peek(), len);
             return str;
         }
 
@@ -77,32 +134,178 @@ namespace schwi
 
         void append(const char *data, size_t len)
         {
+            if (_chained)
+            {
+                appendChain(data, len);
+                return;
+            }
             ensureWritableBytes(len);
             std::copy(data, data + len, beginWrite());
             _writerIndex += len;
         }
 
-        const char *findCRLF() const
+        void push_back(char c)
         {
-            const char *crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF + 2);
+            *reserve(1) = c;
+            commit(1);
+        }
+
+        /**
+         * @brief 预留至少 len 字节的连续可写空间, 写入后调用 commit 提交实际写入的字节数
+         *
+         * 返回的指针在下一次修改缓冲区之前有效; 链式模式下预留在末尾的分段中。
+         */
+        char *reserve(size_t len);
+        void commit(size_t len)
+        {
+            if (_chained)
+            {
+                _segments.back().end += len;
+                _chainBytes += len;
+            }
+            else
+            {
+                _writerIndex += len;
+            }
+        }
+
+        /**
+         * @brief 按 fmt 格式直接格式化到缓冲区末尾, 不经过临时字符串
+         */
+        template <typename... Args>
+        void appendFormat(fmt::format_string<Args...> format, Args &&...args)
+        {
+            // 先按现有空间格式化, 放不下时按实际长度预留后重新格式化一次
+            size_t available = std::max(writableSpace(), kMinFormatReserve);
+            auto result = fmt::format_to_n(reserve(available), available, format, std::forward<Args>(args)...);
+            if (result.size > available)
+            {
+                available = result.size;
+                fmt::format_to_n(reserve(available), available, format, std::forward<Args>(args)...);
+            }
+            commit(result.size);
+        }
+
+        /**
+         * @brief 在可读数据之前写入 data, 用于数据写完后再补写长度头
+         *
+         * 连续模式下使用预留区, 预留区不足时后移数据腾出空间; 链式模式下作为新分段插在最前面。
+         */
+        void prepend(const void *data, size_t len);
+
+        /**
+         * @brief 追加并接管字符串, 链式模式下不拷贝数据
+         */
+        void append(std::string &&str);
+
+        /**
+         * @brief 追加共享的外部内存, 链式模式下只持有引用, 调用方之后不能再修改这段内存
+         */
+        void append(std::shared_ptr<const char[]> data, size_t len);
+
+        /**
+         * @brief 追加由 owner 持有的内存 [data, data + len), 链式模式下只持有 owner 不拷贝
+         */
+        void append(std::shared_ptr<const void> owner, const char *data, size_t len);
+
+        /**
+         * @brief 取走 other 的全部数据, 两者都是链式时只转移分段不拷贝
+         */
+        void append(Buffer &&other);
+
+        /**
+         * @brief 链式模式下队首分段的未读数据, 返回持有该内存的对象
+         *
+         * 持有返回的对象期间该分段不会再被写入或释放, 用于 MSG_ZEROCOPY 等需要在发送完成前保留内存的场景。
+         */
+        std::shared_ptr<const void> frontSegment(const char **data, size_t *len) const;
+
+        /**
+         * @brief 按顺序把可读数据的各段填入 iov, 最多 maxCount 段、maxBytes 字节
+         *
+         * 地址在下一次修改缓冲区之前有效, 用于 writev 或交给 io_uring 异步发送。
+         * @return 填入的段数
+         */
+        size_t peekSegments(struct iovec *iov, size_t maxCount, size_t maxBytes = SIZE_MAX) const;
+
+        /**
+         * @brief 在可读区域中查找 "\r\n", 找不到返回 nullptr
+         * @param start 从该位置开始查找, 增量解析时传入上次检查到的位置以免重复扫描
+         */
+        const char *findCRLF() const { return findCRLF(peek()); }
+        const char *findCRLF(const char *start) const
+        {
+            const char *crlf = ByteSearch::findCRLF(start, beginWrite());
             return crlf == beginWrite() ? nullptr : crlf;
         }
 
+        const char *findEOL() const { return findEOL(peek()); }
+        const char *findEOL(const char *start) const
+        {
+            const char *eol = ByteSearch::findEOL(start, beginWrite());
+            return eol == beginWrite() ? nullptr : eol;
+        }
+
+        const char *findByte(char c) const { return findByte(peek(), c); }
+        const char *findByte(const char *start, char c) const
+        {
+            const char *found = ByteSearch::findByte(start, beginWrite(), c);
+            return found == beginWrite() ? nullptr : found;
+        }
+
         char *beginWrite() { return begin() + _writerIndex; }
         const char *beginWrite() const { return begin() + _writerIndex; }
 
-        ssize_t readFd(int fd, int *savedErrno);
-        ssize_t writeFd(int fd, int *savedErrno);
+        /**
+         * @brief 从fd读取数据
+         *
+         * 先读入缓冲区的可写空间, 超出部分经由loop共用(或线程局部)的临时缓冲拷入, 临时缓冲不做清零。
+         * @param predictor 非空时先按预测的大小预留可写空间, 使大部分数据直接读入缓冲区, 并记录本次读取的大小
+         */
+        ssize_t readFd(int fd, int *savedErrno, ReadSizePredictor *predictor = nullptr);
+        ssize_t writeFd(int fd, int *savedErrno, size_t maxBytes = SIZE_MAX); // 最多写出 maxBytes 字节
 
     private:
-        char *begin() { return &*(_buffer.begin()); }
-        const char *begin() const { return &*(_buffer.begin()); }
+        /**
+         * @brief 链式模式下的一个分段, owner 持有内存, [begin, end) 为未读数据
+         */
+        struct Segment
+        {
+            std::shared_ptr<const void> owner;
+            const char *data;
+            size_t begin;
+            size_t end;
+            size_t capacity; // 库内分配的分段可继续写到capacity, 外部内存等于end
+        };
+
+        char *begin() { return _data != nullptr ? _data : kEmpty; }
+        const char *begin() const { return _data != nullptr ? _data : kEmpty; }
+
+        static constexpr size_t kMinFormatReserve = 64; // appendFormat 第一次格式化时至少预留的空间
 
+        size_t writableSpace() const;
         void makeSpace(size_t len);
+        void makeFrontSpace(size_t len);
+        void reallocate(size_t size);
+        void releaseStorage();
+        static void releaseData(char *data, size_t capacity, BufferPool *pool);
 
-        std::vector<char> _buffer;
+        void appendChain(const char *data, size_t len);
+        void appendSegment(std::shared_ptr<const void> owner, const char *data, size_t len);
+        void retrieveChain(size_t len);
+        std::string copyChain(size_t len) const;
+        ssize_t writeChain(int fd, int *savedErrno, size_t maxBytes);
+
+        char *_data;      // 连续内存, 未借用时为 nullptr
+        size_t _capacity; // _data 的大小
+        BufferPool *_pool;
         size_t _readerIndex;
         size_t _writerIndex;
-        static const char kCRLF[];
+
+        bool _chained;
+        std::deque<Segment> _segments;
+        size_t _chainBytes;
+
+        static char kEmpty[kCheapPrepend]; // 未分配内存时 peek/beginWrite 指向的位置
     };
 } // namespace schwi
\ No newline at end of file
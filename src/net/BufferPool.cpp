@@ -0,0 +1,100 @@
+#include "net/BufferPool.hpp"
+
+#include <bit>
+#include <algorithm>
+#include <stdlib.h>
+
+namespace schwi
+{
+    BufferPool::~BufferPool()
+    {
+        for (SizeClass &sizeClass : _classes)
+        {
+            for (char *data : sizeClass.free)
+            {
+                ::free(data);
+            }
+        }
+        ::free(_scratch);
+    }
+
+    char *BufferPool::scratch()
+    {
+        if (_scratch == nullptr)
+        {
+            _scratch = static_cast<char *>(::malloc(kScratchSize));
+        }
+        return _scratch;
+    }
+
+    size_t BufferPool::roundUp(size_t size)
+    {
+        if (size <= kMinClassSize)
+        {
+            return kMinClassSize;
+        }
+        if (size > kMaxClassSize)
+        {
+            return size;
+        }
+        return std::bit_ceil(size);
+    }
+
+    int BufferPool::classIndex(size_t capacity)
+    {
+        if (capacity > kMaxClassSize || !std::has_single_bit(capacity) || capacity < kMinClassSize)
+        {
+            return -1;
+        }
+        return std::countr_zero(capacity) - std::countr_zero(kMinClassSize);
+    }
+
+    char *BufferPool::allocate(size_t size, size_t *capacity)
+    {
+        *capacity = roundUp(size);
+        _borrowedBytes += *capacity;
+
+        int index = classIndex(*capacity);
+        if (index >= 0 && !_classes[index].free.empty())
+        {
+            SizeClass &sizeClass = _classes[index];
+            char *data = sizeClass.free.back();
+            sizeClass.free.pop_back();
+            sizeClass.minFree = std::min(sizeClass.minFree, sizeClass.free.size());
+            _cachedBytes -= *capacity;
+            return data;
+        }
+        return static_cast<char *>(::malloc(*capacity));
+    }
+
+    void BufferPool::deallocate(char *data, size_t capacity)
+    {
+        _borrowedBytes -= capacity;
+
+        int index = classIndex(capacity);
+        if (index < 0 || (_classes[index].free.size() + 1) * capacity > kMaxCachedBytesPerClass)
+        {
+            ::free(data);
+            return;
+        }
+        _classes[index].free.push_back(data);
+        _cachedBytes += capacity;
+    }
+
+    void BufferPool::trim()
+    {
+        for (int index = 0; index < kNumClasses; ++index)
+        {
+            SizeClass &sizeClass = _classes[index];
+            size_t capacity = kMinClassSize << index;
+            // 空闲链表按后进先出使用, 底部的 minFree 个块整个周期都没有被借出
+            for (size_t i = 0; i < sizeClass.minFree; ++i)
+            {
+                ::free(sizeClass.free[i]);
+            }
+            sizeClass.free.erase(sizeClass.free.begin(), sizeClass.free.begin() + sizeClass.minFree);
+            _cachedBytes -= sizeClass.minFree * capacity;
+            sizeClass.minFree = sizeClass.free.size();
+        }
+    }
+} // namespace schwi
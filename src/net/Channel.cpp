@@ -14,6 +14,9 @@ namespace schwi
           _events(0),
           _revents(0),
           _index(-1),
+          _edgeTriggered(false),
+          _dirty(false),
+          _applied(0),
           _tied(false)
     {
     }
@@ -74,6 +77,18 @@ namespace schwi
         update();
     }
 
+    void Channel::setEdgeTriggered(bool on)
+    {
+        if (_edgeTriggered != on)
+        {
+            _edgeTriggered = on;
+            if (!isNoneEvent())
+            {
+                update();
+            }
+        }
+    }
+
     void Channel::update()
     {
         _loop->updateChannel(this);
@@ -93,8 +108,8 @@ namespace schwi
                 _closeCallback();
         }
 
-        // 错误
-        if (_revents & EPOLLERR)
+        // 错误; 先交给错误队列回调, 完成通知等不算错误
+        if ((_revents & EPOLLERR) && !(_errorQueueCallback && _errorQueueCallback()))
         {
             LOG_ERROR("Channel::handleEventWithGuard() EPOLLERR: fd = {}", _fd);
             if (_errorCallback)
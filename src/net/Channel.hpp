@@ -16,6 +16,7 @@ namespace schwi
     public:
         using EventCallback = std::function<void()>;
         using ReadEventCallback = std::function<void(Timestamp)>;
+        using ErrorQueueCallback = std::function<bool()>; // 返回 true 表示 EPOLLERR 由错误队列中的通知引起, 不是错误
 
         Channel(EventLoop *loop, int fd);
         ~Channel();
@@ -26,6 +27,7 @@ namespace schwi
         void setWriteCallback(const EventCallback &cb) { _writeCallback = std::move(cb); }   // 设置写回调
         void setCloseCallback(const EventCallback &cb) { _closeCallback = std::move(cb); }   // 设置关闭回调
         void setErrorCallback(const EventCallback &cb) { _errorCallback = std::move(cb); }   // 设置错误回调
+        void setErrorQueueCallback(const ErrorQueueCallback &cb) { _errorQueueCallback = cb; } // 设置错误队列回调(如MSG_ZEROCOPY完成通知)
 
         void tie(const std::shared_ptr<void> &obj); // 绑定对象
 
@@ -39,6 +41,9 @@ namespace schwi
         void disableWriting(); // 禁用写
         void disableAll();     // 禁用所有
 
+        void setEdgeTriggered(bool on);                       // 设置边沿触发(EPOLLET)
+        bool edgeTriggered() const { return _edgeTriggered; } // 是否边沿触发
+
         bool isNoneEvent() const { return _events == kNoneEvent; } // 是否无事件
         bool isWriting() const { return _events & kWriteEvent; }   // 是否写事件
         bool isReading() const { return _events & kReadEvent; }    // 是否读事件
@@ -46,6 +51,12 @@ namespace schwi
         int index() { return _index; }            // 获取索引
         void set_index(int idx) { _index = idx; } // 设置索引
 
+        int interest() const { return _events | (_edgeTriggered ? static_cast<int>(EPOLLET) : 0); } // 需要注册到Poller的事件
+        bool dirty() const { return _dirty; }                                     // 是否有待提交的关注事件修改
+        void set_dirty(bool on) { _dirty = on; }                                  // 设置待提交标志
+        int applied() const { return _applied; }                                  // 最近一次提交给Poller的事件
+        void set_applied(int events) { _applied = events; }                       // 设置已提交的事件
+
         EventLoop *ownerLoop() { return _loop; } // 获取事件循环
         void remove();
 
@@ -57,11 +68,14 @@ namespace schwi
         static const int kReadEvent;  // 读事件
         static const int kWriteEvent; // 写事件
 
-        EventLoop *_loop; // 当前Channel属于的EventLoop
-        const int _fd;    // fd, Poller监听对象
-        int _events;      // 注册fd感兴趣的事件
-        int _revents;     // poller返回的具体发生的事件
-        int _index;       // 在Poller上注册的情况
+        EventLoop *_loop;    // 当前Channel属于的EventLoop
+        const int _fd;       // fd, Poller监听对象
+        int _events;         // 注册fd感兴趣的事件
+        int _revents;        // poller返回的具体发生的事件
+        int _index;          // 在Poller上注册的情况
+        bool _edgeTriggered; // 是否以EPOLLET注册, 回调需要读写到EAGAIN
+        bool _dirty;         // 是否在EventLoop的待提交列表中
+        int _applied;        // 已提交给Poller的事件
 
         std::weak_ptr<void> _tie; // 弱指针指向TcpConnection
         bool _tied;               // 标志此 Channel 是否被调用过 Channel::tie 方法
@@ -70,5 +84,6 @@ namespace schwi
         EventCallback _writeCallback;
         EventCallback _closeCallback;
         EventCallback _errorCallback;
+        ErrorQueueCallback _errorQueueCallback;
     };
 } // namespace schwi
\ No newline at end of file
@@ -1,7 +1,14 @@
 #include "net/EventLoop.hpp"
 #include "net/poller/Poller.hpp"
+#include "net/poller/IoUringPoller.hpp"
+#include "net/BufferPool.hpp"
+#include "net/IdleReaper.hpp"
 #include "base/base.hpp"
+#include "timer/TimerQueue.hpp"
+#include "timer/TimerWheel.hpp"
 
+#include <chrono>
+#include <algorithm>
 #include <sys/eventfd.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -11,6 +18,7 @@ namespace schwi
     thread_local EventLoop *t_loopInThisThread = nullptr;
 
     const int kPollTimeMs = 10000;
+    const double kPoolTrimInterval = 10.0; // 缓冲区内存池回收空闲内存的周期(秒)
 
     int createEventfd()
     {
@@ -23,16 +31,29 @@ namespace schwi
         return evtfd;
     }
 
-    EventLoop::EventLoop()
+    EventLoop::EventLoop(PollerBackend backend)
         : _looping(false),
           _quit(false),
           _callingPendingFunctors(false),
           _threadId(CurrentThread::tid()),
-          _poller(Poller::newDefaultPoller(this)),
+          _now(MonoTime::now()),
+          _poller(Poller::newDefaultPoller(this, backend)),
+          _ioUring(nullptr),
+          _savedChannelUpdates(0),
           _timerQueue(new TimerQueue(this)),
+          _bufferPool(new BufferPool),
+          _idleReaper(new IdleReaper(this)),
+          _lastPoolTrim(_now),
+          _timerfdEnabled(true),
+          _timerWheelTick(0.0),
           _wakeupFd(createEventfd()),
           _wakeupChannel(new Channel(this, _wakeupFd)),
-          _currentActiveChannel(nullptr)
+          _currentActiveChannel(nullptr),
+          _drainScheduled(false),
+          _busyPollMicros(0),
+          _socketBusyPollMicros(0),
+          _spinHits(0),
+          _spinMisses(0)
     {
         LOG_DEBUG("EventLoop created {} the index is {}", this, _threadId);
         LOG_DEBUG("EventLoop created wakeupFd = {}", _wakeupFd);
@@ -44,6 +65,11 @@ namespace schwi
         {
             t_loopInThisThread = this;
         }
+        IoUringPoller *ioUring = dynamic_cast<IoUringPoller *>(_poller.get());
+        if (ioUring != nullptr && ioUring->completionIo())
+        {
+            _ioUring = ioUring;
+        }
         _wakeupChannel->setReadCallback(std::bind(&EventLoop::handleRead, this));
         _wakeupChannel->enableReading();
     }
@@ -54,6 +80,10 @@ namespace schwi
         _wakeupChannel->disableAll();
         _wakeupChannel->remove();
         ::close(_wakeupFd);
+        while (PendingFunctor *pending = _pendingFunctors.pop())
+        {
+            delete pending;
+        }
         t_loopInThisThread = nullptr;
     }
 
@@ -61,17 +91,41 @@ namespace schwi
     {
         _looping = true;
         _quit = false;
+        _now = MonoTime::now();
         LOG_INFO("EventLoop {} start looping", this);
 
         while (!_quit)
         {
             _activeChannels.clear();
-            _pollReturnTime = _poller->poll(kPollTimeMs, &_activeChannels);
+            flushChannelUpdates();
+            int timeoutMs = _timerfdEnabled ? kPollTimeMs : pollTimeoutMs();
+            if (_busyPollMicros > 0)
+            {
+                _pollReturnTime = busyPoll(timeoutMs);
+            }
+            else
+            {
+                _pollReturnTime = _poller->poll(timeoutMs, &_activeChannels);
+            }
+            _now = MonoTime::now();
+            if (!_timerfdEnabled)
+            {
+                _timerQueue->processExpired(_now);
+            }
+            // 处理事件期间loop处于唤醒状态, 随后的doPendingFunctors会取走新投递的回调
+            _drainScheduled.store(true, std::memory_order_release);
             for (Channel *channel : _activeChannels)
             {
                 channel->handleEvent(_pollReturnTime);
             }
             doPendingFunctors();
+            doAfterDispatch();
+
+            if (_now >= addTime(_lastPoolTrim, kPoolTrimInterval))
+            {
+                _bufferPool->trim();
+                _lastPoolTrim = _now;
+            }
         }
 
         LOG_INFO("EventLoop {} stop looping", this);
@@ -81,35 +135,50 @@ namespace schwi
     void EventLoop::quit()
     {
         _quit = true;
-        if (isInLoopThread())
+        // 在其他线程中调用时loop可能阻塞在poll中, 需要唤醒
+        if (!isInLoopThread())
         {
             wakeup();
         }
     }
 
-    void EventLoop::runInLoop(Functor cb)
+    void EventLoop::queuePending(PendingFunctor *pending)
     {
-        if (isInLoopThread())
-        {
-            cb();
-        }
-        else
+        _pendingFunctors.push(pending);
+
+        // 已有唤醒在途或loop尚未进入阻塞时, 省掉多余的eventfd写入
+        if ((!isInLoopThread() || _callingPendingFunctors) &&
+            !_drainScheduled.exchange(true, std::memory_order_acq_rel))
         {
-            queueInLoop(cb);
+            wakeup();
         }
     }
 
-    void EventLoop::queueInLoop(Functor cb)
+    void EventLoop::runAfterDispatch(Functor cb)
     {
+        _afterDispatch.push_back(std::move(cb));
+    }
+
+    void EventLoop::doAfterDispatch()
+    {
+        if (_afterDispatch.empty())
         {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _pendingFunctors.emplace_back(cb);
+            return;
         }
-
-        if (!isInLoopThread() || _callingPendingFunctors)
+        // 此时已过了doPendingFunctors, 回调中投递的任务需要写eventfd才能在下一轮执行
+        _callingPendingFunctors = true;
+        std::vector<Functor> functors;
+        // 回调中再次登记的也在本轮执行, 保证阻塞前全部处理完
+        while (!_afterDispatch.empty())
         {
-            wakeup();
+            functors.swap(_afterDispatch);
+            for (const Functor &functor : functors)
+            {
+                functor();
+            }
+            functors.clear();
         }
+        _callingPendingFunctors = false;
     }
 
     void EventLoop::wakeup()
@@ -124,34 +193,159 @@ namespace schwi
 
     void EventLoop::updateChannel(Channel *channel)
     {
-        _poller->updateChannel(channel);
+        if (channel->dirty())
+        {
+            countSavedChannelUpdate();
+            return;
+        }
+        channel->set_dirty(true);
+        _dirtyChannels.push_back(channel);
     }
 
     void EventLoop::removeChannel(Channel *channel)
     {
+        if (channel->dirty())
+        {
+            _dirtyChannels.erase(std::find(_dirtyChannels.begin(), _dirtyChannels.end(), channel));
+            channel->set_dirty(false);
+            countSavedChannelUpdate();
+        }
+        channel->set_applied(0);
         _poller->removeChannel(channel);
     }
 
+    void EventLoop::flushChannelUpdates()
+    {
+        for (Channel *channel : _dirtyChannels)
+        {
+            channel->set_dirty(false);
+            // 本轮内相互抵消的修改(如先enable再disable)不需要提交
+            if (channel->interest() == channel->applied())
+            {
+                countSavedChannelUpdate();
+                continue;
+            }
+            channel->set_applied(channel->interest());
+            _poller->updateChannel(channel);
+        }
+        _dirtyChannels.clear();
+    }
+
+    void EventLoop::countSavedChannelUpdate()
+    {
+        _savedChannelUpdates.store(_savedChannelUpdates.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
     void EventLoop::hasChannel(Channel *channel)
     {
         _poller->hasChannel(channel);
     }
 
-    void EventLoop::runAt(const Timestamp &time, Functor cb)
+    TimerId EventLoop::runAt(const Timestamp &time, Functor cb)
+    {
+        // 墙上时间只在添加时换算一次, 之后系统时间的调整不再影响该定时器
+        return _timerQueue->addTimer(std::move(cb), MonoTime::fromTimestamp(time), 0.0);
+    }
+
+    TimerId EventLoop::runAfter(double delay, Functor cb)
     {
-        _timerQueue->addTimer(std::move(cb), time, 0.0);
+        MonoTime time(addTime(timerBase(), delay));
+        return _timerQueue->addTimer(std::move(cb), time, 0.0);
     }
 
-    void EventLoop::runAfter(double delay, Functor cb)
+    TimerId EventLoop::runEvery(double interval, Functor cb)
     {
-        Timestamp time(addTime(Timestamp::now(), delay));
-        _timerQueue->addTimer(std::move(cb), time, 0.0);
+        MonoTime time(addTime(timerBase(), interval));
+        return _timerQueue->addTimer(std::move(cb), time, interval);
     }
 
-    void EventLoop::runEvery(double interval, Functor cb)
+    MonoTime EventLoop::timerBase() const
     {
-        Timestamp time(addTime(Timestamp::now(), interval));
-        _timerQueue->addTimer(std::move(cb), time, interval);
+        // loop线程中直接使用本轮缓存的时间, 省去一次取时钟
+        return _looping && isInLoopThread() ? _now : MonoTime::now();
+    }
+
+    void EventLoop::cancel(TimerId timerId)
+    {
+        _timerQueue->cancel(timerId);
+    }
+
+    void EventLoop::useTimerWheel(double tick)
+    {
+        if (!isInLoopThread())
+        {
+            LOG_ERROR("EventLoop::useTimerWheel() must be called in loop thread");
+            return;
+        }
+        _timerWheelTick = tick;
+        resetTimerQueue();
+    }
+
+    void EventLoop::disableTimerfd()
+    {
+        if (!isInLoopThread())
+        {
+            LOG_ERROR("EventLoop::disableTimerfd() must be called in loop thread");
+            return;
+        }
+        _timerfdEnabled = false;
+        resetTimerQueue();
+    }
+
+    void EventLoop::resetTimerQueue()
+    {
+        if (_timerWheelTick > 0.0)
+        {
+            _timerQueue.reset(new TimerWheel(this, _timerWheelTick, _timerfdEnabled));
+        }
+        else
+        {
+            _timerQueue.reset(new TimerQueue(this, _timerfdEnabled));
+        }
+    }
+
+    int EventLoop::pollTimeoutMs() const
+    {
+        MonoTime next = _timerQueue->nextExpiration();
+        if (!next.valid())
+        {
+            return kPollTimeMs;
+        }
+
+        // 向上取整到毫秒, 避免提前醒来后空转
+        int64_t micros = next.microseconds() - MonoTime::now().microseconds();
+        if (micros <= 0)
+        {
+            return 0;
+        }
+        return static_cast<int>(std::min<int64_t>((micros + 999) / 1000, kPollTimeMs));
+    }
+
+    Timestamp EventLoop::busyPoll(int timeoutMs)
+    {
+        // 自旋不超过本次poll的超时, 否则会推迟到期的定时器; 超时为0时只poll一次
+        const int64_t spinMicros = _busyPollMicros.load(std::memory_order_relaxed);
+        const int64_t timeoutMicros = static_cast<int64_t>(timeoutMs) * 1000;
+        const auto deadline = std::chrono::steady_clock::now() +
+                              std::chrono::microseconds(std::min(spinMicros, timeoutMicros));
+        Timestamp receiveTime;
+        do
+        {
+            receiveTime = _poller->poll(0, &_activeChannels);
+            if (!_activeChannels.empty())
+            {
+                _spinHits.store(_spinHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return receiveTime;
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+
+        if (spinMicros >= timeoutMicros)
+        {
+            // 超时已在自旋中耗尽, 不再阻塞
+            return receiveTime;
+        }
+        _spinMisses.store(_spinMisses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return _poller->poll(static_cast<int>((timeoutMicros - spinMicros) / 1000), &_activeChannels);
     }
 
     void EventLoop::handleRead()
@@ -166,18 +360,14 @@ namespace schwi
 
     void EventLoop::doPendingFunctors()
     {
-        std::vector<Functor> functors;
         _callingPendingFunctors = true;
+        _drainScheduled.exchange(false, std::memory_order_acq_rel);
 
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            functors.swap(_pendingFunctors);
-        }
-
-        for (const Functor &functor : functors)
-        {
-            functor();
-        }
+        // 只处理此刻之前投递的回调, 回调中再次投递的留到下一轮
+        _pendingFunctors.consume([](PendingFunctor *pending)
+                                 {
+            pending->run();
+            delete pending; });
         _callingPendingFunctors = false;
     }
 }
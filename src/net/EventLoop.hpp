@@ -4,24 +4,40 @@
 #include <vector>
 #include <functional>
 #include <atomic>
-#include <mutex>
+#include <type_traits>
+#include <utility>
 
 #include "base/noncopyable.hpp"
 #include "base/Timestamp.hpp"
+#include "base/MonoTime.hpp"
 #include "base/CurrentThread.hpp"
-#include "timer/TimerQueue.hpp"
+#include "base/MpscQueue.hpp"
+#include "timer/ITimerQueue.hpp"
 
 namespace schwi
 {
     class Channel;
     class Poller;
+    class IoUringPoller;
+    class BufferPool;
+    class IdleReaper;
+
+    /**
+     * @brief EventLoop 使用的事件通知后端
+     */
+    enum class PollerBackend
+    {
+        kDefault, // epoll; 设置了环境变量 TINY_NETWORK_USE_IO_URING 时同 kIoUring
+        kEpoll,
+        kIoUring, // io_uring, 内核不支持时退回 epoll; 支持提供缓冲环时连接的收发也经由 io_uring 完成
+    };
 
     class EventLoop : noncopyable
     {
     public:
         using Functor = std::function<void()>;
 
-        EventLoop();
+        explicit EventLoop(PollerBackend backend = PollerBackend::kDefault);
         ~EventLoop();
 
         void loop();
@@ -29,24 +45,126 @@ namespace schwi
 
         Timestamp pollReturnTime() const { return _pollReturnTime; }
 
-        void runInLoop(Functor cb);
-        void queueInLoop(Functor cb);
+        /**
+         * @brief 在loop线程中执行 cb, 当前就在loop线程时立即执行
+         *
+         * cb 可以是只能移动的可调用对象(如捕获了 std::string&& 或 Buffer 的 lambda),
+         * 投递时只移动一次到队列节点中, 不经过 std::function 的拷贝。
+         */
+        template <typename F>
+        void runInLoop(F &&cb)
+        {
+            if (isInLoopThread())
+            {
+                cb();
+            }
+            else
+            {
+                queueInLoop(std::forward<F>(cb));
+            }
+        }
+
+        template <typename F>
+        void queueInLoop(F &&cb)
+        {
+            queuePending(new PendingTask<std::decay_t<F>>(std::forward<F>(cb)));
+        }
 
         void wakeup();
 
-        void updateChannel(Channel *channel);
+        /**
+         * @brief 在本轮事件和待执行回调都处理完、下一次poll之前执行 cb, 只执行一次, 只能在loop线程调用
+         *
+         * 用于把本轮内的多次修改合并成一次提交, 如 TcpConnection 的 cork 模式每轮只写一次socket
+         */
+        void runAfterDispatch(Functor cb);
+
+        void updateChannel(Channel *channel); // 记录修改, 在下一次poll前统一提交
         void removeChannel(Channel *channel);
         void hasChannel(Channel *channel);
 
         bool isInLoopThread() const { return _threadId == CurrentThread::tid(); }
 
-        void runAt(const Timestamp &time, Functor cb);
-        void runAfter(double delay, Functor cb);
-        void runEvery(double interval, Functor cb);
+        /**
+         * @brief 本轮poll返回时的单调时间, 每轮只取一次时钟, 只能在loop线程使用
+         */
+        MonoTime now() const { return _now; }
+
+        TimerId runAt(const Timestamp &time, Functor cb);
+        TimerId runAfter(double delay, Functor cb);
+        TimerId runEvery(double interval, Functor cb);
+        void cancel(TimerId timerId);
+
+        /**
+         * @brief 改用分层时间轮管理该loop的定时器, 精度为tick秒
+         *
+         * 需要在loop线程中且尚未添加定时器时调用(如ThreadInitCallback中), 已有的定时器会被丢弃
+         */
+        void useTimerWheel(double tick = 0.01);
+
+        /**
+         * @brief 定时器不再使用timerfd: 由最近的超时时刻计算poll超时, poll返回后直接执行到期的定时器
+         *
+         * 省去每次超时的timerfd读取与重设, 调用要求同 useTimerWheel, 可与其组合
+         */
+        void disableTimerfd();
+        bool timerfdEnabled() const { return _timerfdEnabled; }
+
+        /**
+         * @brief 开启忙轮询: 阻塞等待前先以零超时poll自旋 spinMicros 微秒
+         * @param spinMicros 自旋时长, 0 表示关闭
+         * @param socketBusyPollMicros 为该loop上的新连接设置的 SO_BUSY_POLL, 0 表示不设置
+         */
+        void setBusyPoll(int spinMicros, int socketBusyPollMicros = 0)
+        {
+            _busyPollMicros = spinMicros;
+            _socketBusyPollMicros = socketBusyPollMicros;
+        }
+        int busyPollMicros() const { return _busyPollMicros; }
+        int socketBusyPollMicros() const { return _socketBusyPollMicros; }
+
+        uint64_t spinHits() const { return _spinHits.load(std::memory_order_relaxed); }     // 自旋窗口内等到事件的次数
+        uint64_t spinMisses() const { return _spinMisses.load(std::memory_order_relaxed); } // 自旋超时转入阻塞等待的次数
+
+        BufferPool *bufferPool() const { return _bufferPool.get(); } // 本loop上连接缓冲区共用的内存池
+        IoUringPoller *ioUring() const { return _ioUring; }             // 支持基于完成的收发的 io_uring Poller, 没有时为空
+        IdleReaper *idleReaper() const { return _idleReaper.get(); } // 本loop上连接的超时检查与LRU, 除 oldestActivity 外只能在loop线程使用
+
+        uint64_t savedChannelUpdates() const { return _savedChannelUpdates.load(std::memory_order_relaxed); } // 合并掉的Poller更新次数
 
     private:
+        /**
+         * @brief 跨线程投递的回调, 侵入式节点避免额外的容器分配
+         */
+        struct PendingFunctor : MpscQueueNode
+        {
+            virtual ~PendingFunctor() = default;
+            virtual void run() = 0;
+        };
+
+        /**
+         * @brief 直接保存可调用对象的节点, 只要求可移动
+         */
+        template <typename F>
+        struct PendingTask : PendingFunctor
+        {
+            template <typename G>
+            explicit PendingTask(G &&cb) : functor(std::forward<G>(cb)) {}
+            void run() override { functor(); }
+            F functor;
+        };
+
+        void queuePending(PendingFunctor *pending);
+
         void handleRead();
         void doPendingFunctors();
+        void doAfterDispatch();
+        Timestamp busyPoll(int timeoutMs);
+        int pollTimeoutMs() const;
+        MonoTime timerBase() const;
+        void resetTimerQueue();
+        void flushChannelUpdates();
+        void countSavedChannelUpdate();
 
         using ChannelList = std::vector<Channel *>;
         std::atomic_bool _looping;
@@ -54,15 +172,30 @@ namespace schwi
         std::atomic_bool _callingPendingFunctors;
         const pid_t _threadId;
         Timestamp _pollReturnTime;
+        MonoTime _now; // 缓存的单调时间, poll返回后刷新
         std::unique_ptr<Poller> _poller;
-        std::unique_ptr<TimerQueue> _timerQueue;
+        IoUringPoller *_ioUring; // _poller 支持基于完成的收发时指向它
+        ChannelList _dirtyChannels; // 关注事件有修改, 等待提交给Poller的Channel, 需先于其他Channel的持有者构造
+        std::atomic_uint64_t _savedChannelUpdates;
+        std::unique_ptr<ITimerQueue> _timerQueue;
+        std::unique_ptr<BufferPool> _bufferPool;
+        std::unique_ptr<IdleReaper> _idleReaper;
+        MonoTime _lastPoolTrim;
+        bool _timerfdEnabled;
+        double _timerWheelTick; // 为0表示使用TimerQueue
 
         int _wakeupFd;
         std::unique_ptr<Channel> _wakeupChannel;
 
         ChannelList _activeChannels;
         Channel *_currentActiveChannel;
-        std::mutex _mutex;
-        std::vector<Functor> _pendingFunctors;
+        MpscQueue<PendingFunctor> _pendingFunctors;
+        std::atomic_bool _drainScheduled; // 为true时loop保证会在阻塞前执行doPendingFunctors, 无需再写eventfd
+        std::vector<Functor> _afterDispatch; // 本轮末尾执行的回调, 只在loop线程访问
+
+        std::atomic_int _busyPollMicros;
+        std::atomic_int _socketBusyPollMicros;
+        std::atomic_uint64_t _spinHits;
+        std::atomic_uint64_t _spinMisses;
     };
 } // namespace schwi
\ No newline at end of file
@@ -4,13 +4,15 @@
 namespace schwi
 {
     EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
-                                     const std::string &name)
+                                     const std::string &name,
+                                     PollerBackend backend)
         : _loop(nullptr),
           _exiting(false),
           _thread(std::bind(&EventLoopThread::threadFunc, this), name),
           _mutex(),
           _cond(),
-          _callback(cb)
+          _callback(cb),
+          _backend(backend)
     {
     }
 
@@ -43,7 +45,7 @@ namespace schwi
 
     void EventLoopThread::threadFunc()
     {
-        EventLoop loop;
+        EventLoop loop(_backend);
 
         if (_callback)
         {
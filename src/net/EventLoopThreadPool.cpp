@@ -1,5 +1,6 @@
 #include "net/EventLoopThreadPool.hpp"
 #include "net/EventLoopThread.hpp"
+#include "net/EventLoop.hpp"
 
 namespace schwi
 {
@@ -8,6 +9,9 @@ namespace schwi
           _name(name),
           _started(false),
           _numThreads(0),
+          _busyPollMicros(0),
+          _socketBusyPollMicros(0),
+          _backend(PollerBackend::kDefault),
           _next(0)
     {
     }
@@ -24,9 +28,10 @@ namespace schwi
         {
             char buf[_name.size() + 32];
             snprintf(buf, sizeof(buf), "%s%d", _name.c_str(), i);
-            std::unique_ptr<EventLoopThread> t(new EventLoopThread(cb, buf));
+            std::unique_ptr<EventLoopThread> t(new EventLoopThread(cb, buf, _backend));
             _threads.push_back(std::move(t));
             _loops.push_back(_threads.back()->startLoop());
+            _loops.back()->setBusyPoll(_busyPollMicros, _socketBusyPollMicros);
         }
 
         if (_numThreads == 0 && cb)
@@ -35,6 +40,16 @@ namespace schwi
         }
     }
 
+    void EventLoopThreadPool::setBusyPoll(int spinMicros, int socketBusyPollMicros)
+    {
+        _busyPollMicros = spinMicros;
+        _socketBusyPollMicros = socketBusyPollMicros;
+        for (EventLoop *loop : _loops)
+        {
+            loop->setBusyPoll(spinMicros, socketBusyPollMicros);
+        }
+    }
+
     EventLoop *EventLoopThreadPool::getNextLoop()
     {
         EventLoop *loop = _baseLoop;
@@ -0,0 +1,104 @@
+#include "net/IdleReaper.hpp"
+#include "net/EventLoop.hpp"
+#include "net/TcpConnection.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace schwi
+{
+    IdleReaper::IdleReaper(EventLoop *loop)
+        : _loop(loop),
+          _buckets(kBuckets),
+          _current(0),
+          _ticking(false),
+          _oldest(INT64_MAX)
+    {
+    }
+
+    IdleReaper::LruList::iterator IdleReaper::add(const TcpConnectionPtr &conn, int64_t firstCheck)
+    {
+        _lru.emplace_front(conn.get(), secondOf(_loop->now()));
+        updateOldest();
+        if (firstCheck > 0)
+        {
+            schedule(conn, firstCheck);
+        }
+        return _lru.begin();
+    }
+
+    void IdleReaper::touch(LruList::iterator pos)
+    {
+        pos->second = secondOf(_loop->now());
+        _lru.splice(_lru.begin(), _lru, pos);
+        updateOldest();
+    }
+
+    void IdleReaper::remove(LruList::iterator pos)
+    {
+        _lru.erase(pos);
+        updateOldest();
+    }
+
+    void IdleReaper::updateOldest()
+    {
+        _oldest.store(_lru.empty() ? INT64_MAX : _lru.back().second, std::memory_order_relaxed);
+    }
+
+    size_t IdleReaper::evictLeastRecentlyActive(size_t n)
+    {
+        size_t evicted = 0;
+        for (auto it = _lru.rbegin(); it != _lru.rend() && evicted < n; ++it)
+        {
+            // 已在关闭中的连接还没有移出链表, 跳过
+            TcpConnection *conn = it->first;
+            if (conn->connected())
+            {
+                conn->forceClose();
+                ++evicted;
+            }
+        }
+        return evicted;
+    }
+
+    void IdleReaper::schedule(const TcpConnectionPtr &conn, int64_t deadline)
+    {
+        const int64_t now = secondOf(_loop->now());
+        if (!_ticking)
+        {
+            _ticking = true;
+            _current = now;
+            _loop->runEvery(1.0, std::bind(&IdleReaper::onTick, this));
+        }
+        // 桶按 _current 之后的秒编号, 不能放进已经处理过的桶
+        int64_t delta = std::clamp<int64_t>(deadline - _current, 1, kBuckets - 1);
+        _buckets[(_current + delta) % kBuckets].push_back(conn);
+    }
+
+    void IdleReaper::onTick()
+    {
+        const int64_t now = secondOf(_loop->now());
+        // loop阻塞过久时补上错过的桶, 最多转一圈
+        int64_t end = std::min(now, _current + kBuckets);
+        while (_current < end)
+        {
+            ++_current;
+            std::vector<std::weak_ptr<TcpConnection>> due;
+            due.swap(_buckets[_current % kBuckets]);
+            for (const std::weak_ptr<TcpConnection> &weak : due)
+            {
+                TcpConnectionPtr conn = weak.lock();
+                if (!conn || !conn->connected())
+                {
+                    continue;
+                }
+                int64_t next = conn->checkTimeouts(now);
+                if (next > 0)
+                {
+                    schedule(conn, next);
+                }
+            }
+        }
+        _current = std::max(_current, now);
+    }
+} // namespace schwi
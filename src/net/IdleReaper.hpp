@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/noncopyable.hpp"
+#include "base/MonoTime.hpp"
+#include "net/Callback.hpp"
+
+namespace schwi
+{
+    class EventLoop;
+
+    /**
+     * @brief 每个loop一个, 检查本loop上连接的空闲/读/写超时, 并维护按最近活动排序的LRU链表
+     *
+     * 超时检查用按秒划分的桶组成的环: 连接放在下一次可能超时的那一秒的桶里, 每秒只处理当前桶,
+     * 到时重新计算, 没超时就移到新的桶。连接的读写只更新时间戳, 并且每秒最多把连接移到LRU头部一次,
+     * 不需要为每个连接设置定时器。只能在loop线程中使用。
+     */
+    class IdleReaper : noncopyable
+    {
+    public:
+        using LruList = std::list<std::pair<TcpConnection *, int64_t>>; // 连接与其最近一次移到头部的秒
+
+        static constexpr int kBuckets = 64; // 环覆盖的秒数, 更远的期限先放到最远的桶, 到时再重新计算
+
+        explicit IdleReaper(EventLoop *loop);
+
+        static int64_t secondOf(MonoTime time) { return time.microseconds() / Timestamp::kMicroSecondsPerSecond; }
+
+        /**
+         * @brief 登记连接, firstCheck 为第一次检查超时的时刻(秒), 0 表示只加入LRU链表
+         * @return 连接在LRU链表中的位置, 用于 touch/remove
+         */
+        LruList::iterator add(const TcpConnectionPtr &conn, int64_t firstCheck);
+        void touch(LruList::iterator pos); // 移到LRU头部
+        void remove(LruList::iterator pos);
+
+        /**
+         * @brief 强制关闭最久没有活动的 n 个连接, 用于fd将要耗尽时
+         * @return 实际关闭的连接数
+         */
+        size_t evictLeastRecentlyActive(size_t n);
+        size_t size() const { return _lru.size(); }
+
+        // LRU尾部连接最近一次活动的秒, 链表为空时为 INT64_MAX; 可在其他线程读取, 用于在多个loop间选择淘汰对象
+        int64_t oldestActivity() const { return _oldest.load(std::memory_order_relaxed); }
+
+    private:
+        void onTick();
+        void schedule(const TcpConnectionPtr &conn, int64_t deadline);
+        void updateOldest();
+
+        EventLoop *_loop;
+        std::vector<std::vector<std::weak_ptr<TcpConnection>>> _buckets;
+        int64_t _current; // 已处理到的秒
+        bool _ticking;    // 每秒一次的定时器已启动
+        LruList _lru;     // 头部为最近活动的连接
+        std::atomic<int64_t> _oldest;
+    };
+} // namespace schwi
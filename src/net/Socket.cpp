@@ -7,6 +7,8 @@
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
 
 #include "base/base.hpp"
 #include "net/InetAddress.hpp"
@@ -56,7 +58,7 @@ namespace schwi
         ::memset(&addr, 0, addrlen);
 
         int connfd = ::accept4(_sockfd, (sockaddr *)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
-        if (connfd < 0)
+        if (connfd < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
         {
             LOG_ERROR("accept socket:{} failed", _sockfd);
         }
@@ -126,4 +128,74 @@ namespace schwi
             LOG_ERROR("setsockopt SO_KEEPALIVE socket:{} failed", _sockfd);
         }
     }
+
+    /**
+     * @brief 设置忙轮询时长
+     * @param usec 阻塞读时在网卡队列上忙轮询的微秒数
+     */
+    void Socket::setBusyPoll(int usec)
+    {
+        if (::setsockopt(_sockfd, SOL_SOCKET, SO_BUSY_POLL, &usec, static_cast<socklen_t>(sizeof(usec))) != 0)
+        {
+            LOG_ERROR("setsockopt SO_BUSY_POLL socket:{} failed, error:{}", _sockfd, strerror(errno));
+        }
+    }
+
+    /**
+     * @brief 设置接收低水位
+     * @param bytes 接收队列中至少有这么多字节才通知可读(对端关闭或出错时仍会通知)
+     */
+    void Socket::setRecvLowat(int bytes)
+    {
+        if (::setsockopt(_sockfd, SOL_SOCKET, SO_RCVLOWAT, &bytes, static_cast<socklen_t>(sizeof(bytes))) != 0)
+        {
+            LOG_ERROR("setsockopt SO_RCVLOWAT socket:{} failed, error:{}", _sockfd, strerror(errno));
+        }
+    }
+
+    /**
+     * @brief 允许该socket使用 MSG_ZEROCOPY 发送
+     * @return 内核不支持(4.14以前)时返回 false
+     */
+    bool Socket::setZeroCopy(bool on)
+    {
+        int optval = on ? 1 : 0;
+        if (::setsockopt(_sockfd, SOL_SOCKET, SO_ZEROCOPY, &optval, static_cast<socklen_t>(sizeof(optval))) != 0)
+        {
+            LOG_ERROR("setsockopt SO_ZEROCOPY socket:{} failed, error:{}", _sockfd, strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    void Socket::setNotSentLowat(int bytes)
+    {
+        // 内核以无符号数保存, -1 即默认的不限制
+        int optval = bytes > 0 ? bytes : -1;
+        if (::setsockopt(_sockfd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &optval, static_cast<socklen_t>(sizeof(optval))) != 0)
+        {
+            LOG_ERROR("setsockopt TCP_NOTSENT_LOWAT socket:{} failed, error:{}", _sockfd, strerror(errno));
+        }
+    }
+
+    bool Socket::setMaxPacingRate(uint64_t bytesPerSecond)
+    {
+        if (::setsockopt(_sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, &bytesPerSecond, static_cast<socklen_t>(sizeof(bytesPerSecond))) != 0)
+        {
+            LOG_ERROR("setsockopt SO_MAX_PACING_RATE socket:{} failed, error:{}", _sockfd, strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    int Socket::unsentBytes() const
+    {
+        int bytes = 0;
+        if (::ioctl(_sockfd, SIOCOUTQNSD, &bytes) != 0)
+        {
+            LOG_ERROR("ioctl SIOCOUTQNSD socket:{} failed, error:{}", _sockfd, strerror(errno));
+            return -1;
+        }
+        return bytes;
+    }
 } // namespace schwi
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "base/noncopyable.hpp"
 #include "net/InetAddress.hpp"
 
+#include <stdint.h>
+
 namespace schwi
 {
     class Socket : noncopyable
@@ -23,6 +25,12 @@ namespace schwi
         void setReuseAddr(bool on);  // 设置地址复用
         void setReusePort(bool on);  // 设置端口复用
         void setKeepAlive(bool on);  // 设置长连接
+        void setBusyPoll(int usec);  // 设置SO_BUSY_POLL
+        void setRecvLowat(int bytes); // 设置SO_RCVLOWAT, 可读字节数达到该值才通知可读
+        bool setZeroCopy(bool on);    // 设置SO_ZEROCOPY, 内核不支持时返回 false
+        void setNotSentLowat(int bytes); // 设置TCP_NOTSENT_LOWAT, 内核中未发出的字节数低于该值才可写, 0 表示恢复默认
+        int unsentBytes() const;         // 内核发送队列中尚未发出的字节数(SIOCOUTQNSD), 失败返回 -1
+        bool setMaxPacingRate(uint64_t bytesPerSecond); // 设置SO_MAX_PACING_RATE, 由内核按该速率平滑发送, UINT64_MAX 表示不限制
 
     private:
         const int _sockfd;
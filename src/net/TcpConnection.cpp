@@ -1,19 +1,53 @@
 #include "net/TcpConnection.hpp"
+#include "net/BufferPool.hpp"
 #include "net/Channel.hpp"
 #include "net/EventLoop.hpp"
 #include "net/Socket.hpp"
+#include "net/TokenBucket.hpp"
+#include "net/poller/IoUringPoller.hpp"
 #include "base/base.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <string>
+#include <vector>
+#include <limits.h>
+#include <assert.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <poll.h>
 
 namespace schwi
 {
+    const int kMaxReadsPerEvent = 16;  // 边沿触发时单次事件最多读取次数
+    const int kMaxWritesPerEvent = 16; // 边沿触发时单次事件最多写入次数
+    const size_t kMinShapedWrite = 4096; // 限速时至少攒够这么多令牌(或全部待发数据)再恢复写
+    const size_t kFileCopyChunk = 64 * 1024; // 文件不支持 splice 时每次读入内存的字节数
+    const double kZeroCopyLingerSeconds = 60.0; // 连接销毁后最多等待 MSG_ZEROCOPY 完成通知的时间
+
+    /**
+     * @brief 读取并清除socket的 SO_ERROR
+     */
+    static int socketError(int fd)
+    {
+        int optval;
+        socklen_t optlen = sizeof(optval);
+        if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &optval, &optlen))
+        {
+            return errno;
+        }
+        return optval;
+    }
+
     static EventLoop *checkLoopNotNull(EventLoop *loop)
     {
         if (loop == nullptr)
@@ -36,7 +70,32 @@ namespace schwi
           _channel(new Channel(loop, sockfd)),
           _localAddr(localAddr),
           _peerAddr(peerAddr),
-          _highWaterMark(64 * 1024 * 1024)
+          _highWaterMark(64 * 1024 * 1024),
+          _recvLowat(1),
+          _frameScanned(0),
+          _notSentLowat(0),
+          _backpressureHigh(0),
+          _backpressureLow(0),
+          _backpressureHasSource(false),
+          _backpressurePaused(false),
+          _corked(false),
+          _flushScheduled(false),
+          _completionIo(false),
+          _ringSending(0),
+          _sendPaused(false),
+          _idleTimeout(0),
+          _readTimeout(0),
+          _writeTimeout(0),
+          _trackActivity(false),
+          _tracked(false),
+          _lastReadSecond(0),
+          _lastWriteSecond(0),
+          _lastTouchSecond(0),
+          _inputBuffer(loop->bufferPool()),
+          _outputBuffer(loop->bufferPool()),
+          _zeroCopyThreshold(0),
+          _zeroCopyNextId(0),
+          _zeroCopyCopied(0)
     {
         _channel->setReadCallback(
             std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
@@ -46,15 +105,25 @@ namespace schwi
             std::bind(&TcpConnection::handleClose, this));
         _channel->setErrorCallback(
             std::bind(&TcpConnection::handleError, this));
+        _channel->setErrorQueueCallback(
+            std::bind(&TcpConnection::handleErrorQueue, this));
         LOG_DEBUG("TcpConnection::ctor[{}] at {} fd={}",
                   _name.c_str(), this, sockfd);
         _socket->setKeepAlive(true);
+        if (loop->socketBusyPollMicros() > 0)
+        {
+            _socket->setBusyPoll(loop->socketBusyPollMicros());
+        }
     }
 
     TcpConnection::~TcpConnection()
     {
         LOG_DEBUG("TcpConnection::dtor[{}] at {} fd={}",
                   _name.c_str(), this, _channel->fd());
+        clearFileRegions();
+        setSharedSendLimiter(nullptr);
+        // 析构可能发生在任意线程, 未完成的零拷贝发送已在 loop 线程的 connectDestroyed 中移交
+        assert(_zeroCopyPending.empty());
     }
 
     void TcpConnection::send(const std::string &message)
@@ -80,16 +149,91 @@ namespace schwi
         {
             if (_loop->isInLoopThread())
             {
-                sendInLoop(message->peek(), message->readableBytes());
-                message->retrieveAll();
+                sendBufferInLoop(message);
+            }
+            else
+            {
+                send(std::move(*message));
+            }
+        }
+    }
+
+    void TcpConnection::send(std::string &&message)
+    {
+        if (_state == kConnected)
+        {
+            if (_loop->isInLoopThread())
+            {
+                sendInLoop(std::move(message));
+            }
+            else
+            {
+                _loop->runInLoop(
+                    [guardThis = shared_from_this(), message = std::move(message)]() mutable
+                    { guardThis->sendInLoop(std::move(message)); });
+            }
+        }
+    }
+
+    void TcpConnection::send(Buffer &&message)
+    {
+        if (_state == kConnected)
+        {
+            if (_loop->isInLoopThread())
+            {
+                sendBufferInLoop(&message);
+            }
+            else
+            {
+                // 调用方的内存池不能跨线程使用, 内存脱离内存池后随缓冲区移走, 原缓冲区保留其内存池
+                BufferPool *pool = message.pool();
+                message.detachPool();
+                Buffer owned(std::move(message));
+                message.setPool(pool);
+                _loop->runInLoop(
+                    [guardThis = shared_from_this(), owned = std::move(owned)]() mutable
+                    { guardThis->sendBufferInLoop(&owned); });
+            }
+        }
+    }
+
+    void TcpConnection::send(std::span<const iovec> message)
+    {
+        if (_state == kConnected)
+        {
+            if (_loop->isInLoopThread())
+            {
+                sendInLoop(message.data(), message.size(), nullptr);
             }
             else
             {
+                std::string copy;
+                for (const iovec &iov : message)
+                {
+                    copy.append(static_cast<const char *>(iov.iov_base), iov.iov_len);
+                }
                 void (TcpConnection::*fp)(const std::string &message) = &TcpConnection::sendInLoop;
                 _loop->runInLoop(
-                    std::bind(fp,
-                              this,
-                              message->retrieveAllAsString()));
+                    std::bind(fp, this, std::move(copy)));
+            }
+        }
+    }
+
+    void TcpConnection::send(std::span<const iovec> message, std::shared_ptr<const void> owner)
+    {
+        if (_state == kConnected)
+        {
+            if (_loop->isInLoopThread())
+            {
+                sendInLoop(message.data(), message.size(), owner);
+            }
+            else
+            {
+                _loop->runInLoop(
+                    [guardThis = shared_from_this(),
+                     iov = std::vector<iovec>(message.begin(), message.end()),
+                     owner = std::move(owner)]
+                    { guardThis->sendInLoop(iov.data(), iov.size(), owner); });
             }
         }
     }
@@ -99,8 +243,46 @@ namespace schwi
         sendInLoop(message.data(), message.size());
     }
 
+    void TcpConnection::sendInLoop(std::string &&message)
+    {
+        if (!_outputBuffer.chained() || message.size() < Buffer::kMinOwnedAppend)
+        {
+            sendInLoop(message.data(), message.size());
+            return;
+        }
+        // 链式输出时没写完的部分直接引用该字符串
+        auto owner = std::make_shared<const std::string>(std::move(message));
+        iovec iov{const_cast<char *>(owner->data()), owner->size()};
+        sendInLoop(&iov, 1, owner);
+    }
+
+    void TcpConnection::sendBufferInLoop(Buffer *message)
+    {
+        if (message->chained())
+        {
+            // 链式缓冲整体转移到输出缓冲, 链式到链式只转移分段
+            sendInLoop(message);
+        }
+        else
+        {
+            sendInLoop(message->peek(), message->readableBytes());
+            message->retrieveAll();
+        }
+    }
+
     void TcpConnection::sendInLoop(const void *message, size_t len)
     {
+        iovec iov{const_cast<void *>(message), len};
+        sendInLoop(&iov, 1, nullptr);
+    }
+
+    void TcpConnection::sendInLoop(const iovec *iov, size_t count, const std::shared_ptr<const void> &owner)
+    {
+        size_t len = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            len += iov[i].iov_len;
+        }
         ssize_t nwrote = 0;
         size_t remaining = len;
         bool error = false;
@@ -111,11 +293,16 @@ namespace schwi
             return;
         }
         // if no thing in output queue, try writing directly
-        if (!_channel->isWriting() && _outputBuffer.readableBytes() == 0)
+        if (canWriteDirectly() && _outputFiles.empty())
         {
-            nwrote = ::write(_channel->fd(), message, len);
+            nwrote = count == 1 ? ::write(_channel->fd(), iov[0].iov_base, len)
+                                : ::writev(_channel->fd(), iov, static_cast<int>(std::min<size_t>(count, IOV_MAX)));
             if (nwrote >= 0)
             {
+                if (nwrote > 0 && _tracked)
+                {
+                    noteActivity(&_lastWriteSecond);
+                }
                 remaining = len - nwrote;
                 if (remaining == 0 && _writeCompleteCallback)
                 {
@@ -139,141 +326,1394 @@ namespace schwi
 
         if (!error && remaining > 0)
         {
-            size_t oldLen = _outputBuffer.readableBytes();
-            if (oldLen + remaining >= _highWaterMark &&
-                oldLen < _highWaterMark &&
-                _highWaterMarkCallback)
+            size_t oldLen = outputBytes();
+            outputGrew(oldLen, oldLen + remaining);
+            // 有文件在排队时, 数据要等该文件发完再发送
+            Buffer &output = _outputFiles.empty() ? _outputBuffer : _outputFiles.back().after;
+            // 跳过已写出的部分, 只保存剩余的各段
+            size_t skip = nwrote;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (skip >= iov[i].iov_len)
+                {
+                    skip -= iov[i].iov_len;
+                    continue;
+                }
+                const char *data = static_cast<const char *>(iov[i].iov_base) + skip;
+                output.append(owner, data, iov[i].iov_len - skip);
+                skip = 0;
+            }
+            startWriting();
+        }
+    }
+
+    void TcpConnection::sendInLoop(Buffer *message)
+    {
+        if (_state == kDisconnected)
+        {
+            LOG_ERROR("disconnected, give up writing");
+            return;
+        }
+
+        const bool direct = canWriteDirectly() && _outputFiles.empty();
+        const size_t oldLen = outputBytes();
+        Buffer &output = _outputFiles.empty() ? _outputBuffer : _outputFiles.back().after;
+        output.append(std::move(*message));
+
+        if (direct)
+        {
+            int savedErrno = 0;
+            if (writeOutput(&savedErrno) < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
             {
-                _loop->queueInLoop(
-                    std::bind(_highWaterMarkCallback,
-                              shared_from_this(),
-                              oldLen + remaining));
+                LOG_ERROR("TcpConnection::sendInLoop");
             }
-            _outputBuffer.append(static_cast<const char *>(message) + nwrote, remaining);
-            if (!_channel->isWriting())
+            if (outputBytes() == 0)
             {
-                _channel->enableWriting();
+                if (_writeCompleteCallback)
+                {
+                    _loop->queueInLoop(
+                        std::bind(_writeCompleteCallback, shared_from_this()));
+                }
+                return;
             }
         }
+
+        outputGrew(oldLen, outputBytes());
+        startWriting();
     }
 
-    void TcpConnection::shutdown()
+    /**
+     * @brief 输出缓冲有了待发送的数据: 普通模式关注可写事件, cork 模式与经由 io_uring 发送时在本轮末尾统一写一次
+     */
+    void TcpConnection::startWriting()
     {
-        if (_state == kConnected)
+        // 等待令牌或等待队首文件的源可读时不关注可写事件
+        if (_channel->isWriting() || _sendPaused || (_sourceChannel && _sourceChannel->isReading()))
         {
-            setState(kDisconnecting);
-            _loop->runInLoop(
-                std::bind(&TcpConnection::shutdownInLoop, this));
+            return;
+        }
+        if (!_corked && !_completionIo)
+        {
+            _channel->enableWriting();
+        }
+        else if (!_flushScheduled)
+        {
+            _flushScheduled = true;
+            _loop->runAfterDispatch(std::bind(&TcpConnection::flushCorked, shared_from_this()));
         }
     }
 
-    void TcpConnection::shutdownInLoop()
+    void TcpConnection::flushCorked()
     {
-        if (!_channel->isWriting())
+        _flushScheduled = false;
+        if (_state == kDisconnected || _channel->isWriting() || outputBytes() == 0)
         {
-            _socket->shutdownWrite();
+            return;
+        }
+        int savedErrno = 0;
+        ssize_t n = writeShaped(&savedErrno);
+        if (n < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+        {
+            LOG_ERROR("TcpConnection::flushCorked");
+            return;
+        }
+        if (n >= 0)
+        {
+            outputDrained();
+        }
+        if (outputBytes() == 0)
+        {
+            writeCompleted();
+        }
+        else if (!_sendPaused && !(_sourceChannel && _sourceChannel->isReading()))
+        {
+            // 一次没写完, 剩下的按普通方式等待可写事件
+            _channel->enableWriting();
         }
     }
 
-    void TcpConnection::connectEstablished()
+    /**
+     * @brief 输出队列为空且没有 cork、限速与 io_uring 发送时, 新数据可以跳过输出缓冲直接写socket
+     */
+    bool TcpConnection::canWriteDirectly() const
     {
-        setState(kConnected);
-        _channel->tie(shared_from_this());
-        _channel->enableReading();
-
-        _connectionCallback(shared_from_this());
+        return !_corked && !_completionIo && !_sendLimiter && !_sharedSendLimiter &&
+               !_channel->isWriting() && _outputBuffer.readableBytes() == 0;
     }
 
-    void TcpConnection::connectDestroyed()
+    void TcpConnection::setSendRateLimit(double bytesPerSecond, size_t burst)
     {
-        if (_state == kConnected)
+        if (bytesPerSecond <= 0)
         {
-            setState(kDisconnected);
-            _channel->disableAll();
+            if (_sendLimiter)
+            {
+                _sendLimiter.reset();
+                _socket->setMaxPacingRate(UINT64_MAX);
+            }
+            return;
+        }
+        _sendLimiter.reset(new TokenBucket(bytesPerSecond, burst));
+        // 没有 fq 队列规则时内核用TCP内部的定时器实现 pacing, 失败时只靠令牌桶限速
+        _socket->setMaxPacingRate(static_cast<uint64_t>(bytesPerSecond));
+    }
 
-            _connectionCallback(shared_from_this());
+    void TcpConnection::setSharedSendLimiter(std::shared_ptr<TokenBucket> limiter)
+    {
+        if (_sharedSendLimiter)
+        {
+            _sharedSendLimiter->removeUser(&_sharedSendTurn);
+        }
+        _sharedSendLimiter = std::move(limiter);
+        if (_sharedSendLimiter)
+        {
+            _sharedSendLimiter->addUser();
         }
-        _channel->remove();
     }
 
-    void TcpConnection::handleRead(Timestamp receiveTime)
+    /**
+     * @brief 按令牌桶限制写出的字节数, 令牌不足时暂停写并返回 EAGAIN
+     */
+    ssize_t TcpConnection::writeShaped(int *savedErrno)
     {
-        int savedErrno = 0;
-        ssize_t n = _inputBuffer.readFd(_channel->fd(), &savedErrno);
-        if (n > 0)
+        const size_t want = outputBytes();
+        // 没有待发数据(如 io_uring 上的发送刚结束)时不取令牌
+        if ((!_sendLimiter && !_sharedSendLimiter) || want == 0)
         {
-            _messageCallback(shared_from_this(), &_inputBuffer, receiveTime);
+            return writeOutput(savedErrno);
         }
-        else if (n == 0)
+
+        const MonoTime now = _loop->now();
+        // 令牌不够一次最小写入时先暂停攒够, 不把时间花在零碎的小写入上(经由 io_uring 时每次都是一个来回)
+        size_t quota = _sendLimiter ? _sendLimiter->acquire(want, now, std::min(want, kMinShapedWrite)) : want;
+        if (_sharedSendLimiter && quota > 0)
         {
-            handleClose();
+            // 共用的令牌桶每次最多取一个份额, 不够一次最小写入时排队, 让等待中的连接轮流取得令牌
+            size_t cap = std::min(quota, std::max(_sharedSendLimiter->share(), kMinShapedWrite));
+            size_t shared = _sharedSendLimiter->acquire(cap, now, std::min(cap, kMinShapedWrite), &_sharedSendTurn);
+            if (_sendLimiter)
+            {
+                _sendLimiter->giveBack(quota - shared);
+            }
+            quota = shared;
         }
-        else
+        if (quota == 0)
         {
-            errno = savedErrno;
-            LOG_ERROR("TcpConnection::handleRead");
-            handleError();
+            pauseSending(want);
+            *savedErrno = EAGAIN;
+            return -1;
+        }
+
+        ssize_t n = writeOutput(savedErrno, quota);
+        size_t unused = quota - (n > 0 ? static_cast<size_t>(n) : 0);
+        if (_sendLimiter)
+        {
+            _sendLimiter->giveBack(unused);
         }
+        if (_sharedSendLimiter)
+        {
+            _sharedSendLimiter->giveBack(unused);
+        }
+        return n;
     }
 
-    void TcpConnection::handleWrite()
+    void TcpConnection::pauseSending(size_t want)
     {
+        _sendPaused = true;
         if (_channel->isWriting())
         {
-            int saveErrno = 0;
-            ssize_t n = _outputBuffer.writeFd(_channel->fd(), &saveErrno);
-            if (n > 0)
+            _channel->disableWriting();
+        }
+
+        const MonoTime now = _loop->now();
+        const size_t need = std::min(want, kMinShapedWrite);
+        double delay = 0.001;
+        if (_sendLimiter)
+        {
+            delay = std::max(delay, _sendLimiter->delay(need, now));
+        }
+        if (_sharedSendLimiter)
+        {
+            // 按排队位置等待, 不需要每毫秒醒来查看是否轮到自己
+            delay = std::max(delay, _sharedSendLimiter->delay(need, now, &_sharedSendTurn));
+        }
+        std::weak_ptr<TcpConnection> weakThis(shared_from_this());
+        _loop->runAfter(delay, [weakThis]
+                        {
+            if (TcpConnectionPtr conn = weakThis.lock())
             {
-                _outputBuffer.retrieve(n);
-                if (_outputBuffer.readableBytes() == 0)
-                {
-                    _channel->disableWriting();
-                    if (_writeCompleteCallback)
-                    {
-                        _loop->queueInLoop(
-                            std::bind(_writeCompleteCallback, shared_from_this()));
-                    }
-                    if (_state == kDisconnecting)
-                    {
-                        shutdownInLoop();
-                    }
-                }
+                conn->resumeSending();
+            } });
+    }
+
+    void TcpConnection::resumeSending()
+    {
+        _sendPaused = false;
+        if (_state != kDisconnected && outputBytes() > 0)
+        {
+            startWriting();
+        }
+    }
+
+    void TcpConnection::setCorked(bool on)
+    {
+        _corked = on;
+        if (!on && outputBytes() > 0)
+        {
+            startWriting();
+        }
+    }
+
+    /**
+     * @brief 输出积压从 oldLen 增加到 newLen, 越过高水位时回调并按背压策略暂停读取, 由空变为非空时开始写超时计时
+     */
+    void TcpConnection::outputGrew(size_t oldLen, size_t newLen)
+    {
+        if (oldLen == 0 && _tracked)
+        {
+            // 写超时从数据开始等待发送时计时
+            noteActivity(&_lastWriteSecond);
+        }
+        if (newLen >= _highWaterMark &&
+            oldLen < _highWaterMark &&
+            _highWaterMarkCallback)
+        {
+            _loop->queueInLoop(
+                std::bind(_highWaterMarkCallback, shared_from_this(), newLen));
+        }
+        if (_backpressureHigh > 0 && !_backpressurePaused && newLen >= _backpressureHigh)
+        {
+            _backpressurePaused = true;
+            if (!_backpressureHasSource)
+            {
+                stopReadInLoop();
             }
-            else
+            else if (TcpConnectionPtr source = _backpressureSource.lock())
             {
-                LOG_ERROR("TcpConnection::handleWrite");
+                source->stopRead();
             }
         }
-        else
+    }
+
+    /**
+     * @brief 输出积压减少后检查是否可以恢复读取
+     */
+    void TcpConnection::outputDrained()
+    {
+        if (_backpressurePaused && outputBytes() <= _backpressureLow)
         {
-            LOG_ERROR("Connection fd = {} is down, no more writing", _channel->fd());
+            resumeBackpressure();
         }
     }
 
-    void TcpConnection::handleClose()
+    void TcpConnection::resumeBackpressure()
     {
-        LOG_DEBUG("fd = {} state = {}", _channel->fd(), _state.load());
-        setState(kDisconnected);
-        _channel->disableAll();
+        _backpressurePaused = false;
+        if (!_backpressureHasSource)
+        {
+            startReadInLoop();
+        }
+        else if (TcpConnectionPtr source = _backpressureSource.lock())
+        {
+            source->startRead();
+        }
+    }
 
-        TcpConnectionPtr guardThis(shared_from_this());
-        _connectionCallback(guardThis);
-        _closeCallback(guardThis);
+    void TcpConnection::setReadBackpressure(size_t highWaterMark, size_t lowWaterMark, const TcpConnectionPtr &source)
+    {
+        if (_backpressurePaused)
+        {
+            resumeBackpressure();
+        }
+        _backpressureHigh = highWaterMark;
+        _backpressureLow = lowWaterMark < highWaterMark ? lowWaterMark : highWaterMark / 2;
+        _backpressureSource = source;
+        _backpressureHasSource = source != nullptr;
     }
 
-    void TcpConnection::handleError()
+    void TcpConnection::startRead()
     {
-        int optval;
-        socklen_t optlen = sizeof(optval);
-        int err = 0;
-        if (::getsockopt(_channel->fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen))
+        _loop->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+    }
+
+    void TcpConnection::stopRead()
+    {
+        _loop->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+    }
+
+    void TcpConnection::startReadInLoop()
+    {
+        // 连接已断开时Channel可能已从Poller移除, 不能再修改关注事件
+        if (_state == kDisconnected)
         {
-            err = errno;
+            return;
         }
-        else
+        if (!_reading || !_channel->isReading())
+        {
+            _channel->enableReading();
+            _reading = true;
+        }
+    }
+
+    void TcpConnection::stopReadInLoop()
+    {
+        if (_state == kDisconnected)
         {
-            err = optval;
+            return;
+        }
+        if (_reading || _channel->isReading())
+        {
+            _channel->disableReading();
+            _reading = false;
         }
+    }
+
+    void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+    {
+        if (_state == kConnected)
+        {
+            int dupFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+            if (dupFd < 0)
+            {
+                LOG_ERROR("TcpConnection::sendFile [{}] - dup fd {} failed, error:{}", _name, fd, strerror(errno));
+                return;
+            }
+            if (_loop->isInLoopThread())
+            {
+                sendFileInLoop(dupFd, offset, length);
+            }
+            else
+            {
+                _loop->runInLoop(
+                    std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), dupFd, offset, length));
+            }
+        }
+    }
+
+    void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+    {
+        if (_state == kDisconnected || length == 0)
+        {
+            if (length != 0)
+            {
+                LOG_ERROR("disconnected, give up sending file");
+            }
+            ::close(fd);
+            return;
+        }
+
+        // 管道和socket不能指定偏移, sendfile 也不支持: 管道直接 splice, socket 经中转管道 splice
+        struct stat st;
+        bool fifo = ::fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+        bool sock = !fifo && S_ISSOCK(st.st_mode);
+        FileRegion::Mode mode = fifo ? FileRegion::kSplice : (sock ? FileRegion::kPipe : FileRegion::kSendfile);
+
+        size_t oldLen = outputBytes();
+        Buffer after(_loop->bufferPool());
+        after.setChained(_outputBuffer.chained());
+        _outputFiles.push_back(FileRegion{fd, offset, length, fifo || sock, mode, {-1, -1}, 0, Buffer(), std::move(after)});
+
+        if (canWriteDirectly() && _outputFiles.size() == 1)
+        {
+            int savedErrno = 0;
+            if (writeFileRegion(&savedErrno) < 0 && savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+            {
+                LOG_ERROR("TcpConnection::sendFileInLoop");
+                return;
+            }
+            if (outputBytes() == 0)
+            {
+                if (_writeCompleteCallback)
+                {
+                    _loop->queueInLoop(
+                        std::bind(_writeCompleteCallback, shared_from_this()));
+                }
+                return;
+            }
+        }
+
+        outputGrew(oldLen, outputBytes());
+        startWriting();
+    }
+
+    /**
+     * @brief 写socket的错误表示连接已断开, 与 sendInLoop 的判断一致
+     */
+    static bool socketWriteFailed(int err)
+    {
+        return err == EPIPE || err == ECONNRESET;
+    }
+
+    /**
+     * @brief 管道或socket当前是否可读(包括对端关闭与出错), 阻塞的fd在不可读时读取会阻塞loop
+     */
+    static bool sourceReadable(int fd)
+    {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        return ::poll(&pfd, 1, 0) > 0;
+    }
+
+    /**
+     * @brief 发送队首文件的一部分, 发完或文件提前结束时出队
+     * @return 发送的字节数, 出错时返回 -1 并设置 savedErrno; 源暂时没有数据时改为等待源可读并返回 EAGAIN
+     */
+    ssize_t TcpConnection::writeFileRegion(int *savedErrno, size_t maxBytes)
+    {
+        FileRegion &region = _outputFiles.front();
+        const int sockfd = _channel->fd();
+        const size_t len = std::min(region.remaining, maxBytes);
+        ssize_t n = -1;
+        bool sourceFailed = false; // 错误来自读取文件而不是写socket
+        if (region.mode == FileRegion::kSendfile)
+        {
+            n = ::sendfile(sockfd, region.fd, &region.offset, len);
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS || errno == ESPIPE))
+            {
+                region.mode = FileRegion::kPipe;
+            }
+            sourceFailed = n < 0 && !socketWriteFailed(errno);
+        }
+
+        if (region.mode == FileRegion::kSplice)
+        {
+            n = ::splice(region.fd, nullptr, sockfd, nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            sourceFailed = n < 0 && !socketWriteFailed(errno);
+            // EAGAIN 可能来自空管道也可能来自写满的socket, 管道没有数据时等待管道可读
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !sourceReadable(region.fd))
+            {
+                waitForSource();
+                errno = EAGAIN;
+            }
+        }
+        else if (region.mode == FileRegion::kPipe || region.mode == FileRegion::kCopy)
+        {
+            // 中转中的数据不够本次写出时先从源读入
+            if (region.staged < len)
+            {
+                ssize_t staged = stageFileRegion(region, len - region.staged);
+                if (staged <= 0 && region.staged == 0)
+                {
+                    if (staged < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    {
+                        waitForSource();
+                        errno = EAGAIN;
+                    }
+                    n = staged;
+                    sourceFailed = true;
+                }
+            }
+            if (region.staged > 0)
+            {
+                const size_t toWrite = std::min(region.staged, len);
+                if (region.mode == FileRegion::kPipe)
+                {
+                    n = ::splice(region.pipe[0], nullptr, sockfd, nullptr, toWrite, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                }
+                else
+                {
+                    n = ::write(sockfd, region.copy.peek(), toWrite);
+                    if (n > 0)
+                    {
+                        region.copy.retrieve(n);
+                    }
+                }
+                if (n > 0)
+                {
+                    region.staged -= n;
+                }
+            }
+        }
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || !sourceFailed))
+        {
+            // 写socket出错与发送内存数据时一样交给调用方处理
+            *savedErrno = errno;
+            return -1;
+        }
+        if (n <= 0)
+        {
+            // 对端已按长度(如 Content-Length)等待这些字节, 跳过它们接着发送会破坏对端的分帧
+            *savedErrno = n < 0 ? errno : EIO;
+            if (n < 0)
+            {
+                LOG_ERROR("TcpConnection::writeFileRegion [{}] - {} bytes unsent, error:{}",
+                          _name, region.remaining, strerror(*savedErrno));
+            }
+            else
+            {
+                LOG_ERROR("TcpConnection::writeFileRegion [{}] - file ended {} bytes early", _name, region.remaining);
+            }
+            abortOutput();
+            return -1;
+        }
+
+        if (_tracked)
+        {
+            noteActivity(&_lastWriteSecond);
+        }
+        region.remaining -= n;
+        if (region.remaining == 0)
+        {
+            finishFileRegion();
+        }
+        return n;
+    }
+
+    /**
+     * @brief 从源读出最多 len 字节到中转管道(kPipe)或内存(kCopy), 源不支持 splice 时改为 kCopy
+     * @return 读出的字节数, 源已结束时返回 0, 出错时返回 -1 并设置 errno, 源暂时没有数据时为 EAGAIN
+     */
+    ssize_t TcpConnection::stageFileRegion(FileRegion &region, size_t len)
+    {
+        if (region.stream && !sourceReadable(region.fd))
+        {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        if (region.mode == FileRegion::kPipe)
+        {
+            if (region.pipe[0] < 0 && ::pipe2(region.pipe, O_NONBLOCK | O_CLOEXEC) < 0)
+            {
+                return -1;
+            }
+            loff_t offset = region.offset;
+            ssize_t n = ::splice(region.fd, region.stream ? nullptr : &offset, region.pipe[1], nullptr,
+                                 len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n >= 0 || errno != EINVAL || region.staged > 0)
+            {
+                region.offset = static_cast<off_t>(offset);
+                if (n > 0)
+                {
+                    region.staged += n;
+                }
+                return n;
+            }
+            region.mode = FileRegion::kCopy;
+        }
+
+        char buf[kFileCopyChunk];
+        const size_t want = std::min(len, sizeof buf);
+        ssize_t n = region.stream ? ::read(region.fd, buf, want) : ::pread(region.fd, buf, want, region.offset);
+        if (n > 0)
+        {
+            if (!region.stream)
+            {
+                region.offset += n;
+            }
+            region.copy.append(buf, n);
+            region.staged += n;
+        }
+        return n;
+    }
+
+    /**
+     * @brief 队首文件是暂时没有数据的管道或socket: 停止等待socket可写, 改为等待源可读, 避免可写事件空转
+     */
+    void TcpConnection::waitForSource()
+    {
+        if (!_sourceChannel)
+        {
+            _sourceChannel.reset(new Channel(_loop, _outputFiles.front().fd));
+            _sourceChannel->tie(shared_from_this());
+            _sourceChannel->setReadCallback(std::bind(&TcpConnection::handleSourceReady, this));
+            _sourceChannel->setCloseCallback(std::bind(&TcpConnection::handleSourceReady, this));
+            _sourceChannel->setErrorCallback(std::bind(&TcpConnection::handleSourceReady, this));
+        }
+        if (!_sourceChannel->isReading())
+        {
+            _sourceChannel->enableReading();
+        }
+        if (_channel->isWriting())
+        {
+            _channel->disableWriting();
+        }
+    }
+
+    void TcpConnection::handleSourceReady()
+    {
+        _sourceChannel->disableAll();
+        if (_state != kDisconnected && outputBytes() > 0)
+        {
+            startWriting();
+        }
+    }
+
+    /**
+     * @brief 文件没有发完就无法继续: 丢弃全部待发送的数据, 立即发出 FIN 后关闭连接
+     */
+    void TcpConnection::abortOutput()
+    {
+        clearFileRegions();
+        _outputBuffer.retrieveAll();
+        if (_channel->isWriting())
+        {
+            _channel->disableWriting();
+        }
+        _socket->shutdownWrite();
+        forceClose();
+    }
+
+    void TcpConnection::finishFileRegion()
+    {
+        FileRegion &region = _outputFiles.front();
+        closeFileRegion(region);
+        if (region.after.readableBytes() > 0)
+        {
+            // 文件只在输出缓冲为空时发送, 其后的数据直接接管为输出缓冲
+            _outputBuffer = std::move(region.after);
+        }
+        _outputFiles.pop_front();
+    }
+
+    void TcpConnection::clearFileRegions()
+    {
+        for (FileRegion &region : _outputFiles)
+        {
+            closeFileRegion(region);
+        }
+        _outputFiles.clear();
+    }
+
+    void TcpConnection::closeFileRegion(FileRegion &region)
+    {
+        // 等待源可读的 Channel 只会属于队首文件
+        if (_sourceChannel && _sourceChannel->fd() == region.fd)
+        {
+            _sourceChannel->disableAll();
+            _sourceChannel->remove();
+            _sourceChannel.reset();
+        }
+        if (region.pipe[0] >= 0)
+        {
+            ::close(region.pipe[0]);
+            ::close(region.pipe[1]);
+        }
+        ::close(region.fd);
+    }
+
+    size_t TcpConnection::outputBytes() const
+    {
+        size_t bytes = _ringSending + _outputBuffer.readableBytes();
+        for (const FileRegion &region : _outputFiles)
+        {
+            bytes += region.remaining + region.after.readableBytes();
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief 发送一次输出: 输出缓冲非空时发送缓冲, 否则发送队首文件
+     * @return 发送的字节数, 没有待发送数据时返回0, 出错时返回 -1 并设置 savedErrno
+     */
+    ssize_t TcpConnection::writeOutput(int *savedErrno, size_t maxBytes)
+    {
+        if (_ringSending > 0)
+        {
+            // io_uring 上的发送结束前不能写出之后的数据
+            *savedErrno = EAGAIN;
+            return -1;
+        }
+        if (_outputBuffer.readableBytes() == 0)
+        {
+            return _outputFiles.empty() ? 0 : writeFileRegion(savedErrno, maxBytes);
+        }
+        if (_completionIo)
+        {
+            return sendThroughRing(maxBytes);
+        }
+
+        const char *data = nullptr;
+        size_t len = 0;
+        std::shared_ptr<const void> owner;
+        if (_zeroCopyThreshold > 0 &&
+            (owner = _outputBuffer.frontSegment(&data, &len)) != nullptr &&
+            len >= _zeroCopyThreshold)
+        {
+            ssize_t n = ::send(_channel->fd(), data, std::min(len, maxBytes), MSG_ZEROCOPY);
+            if (n > 0)
+            {
+                if (_tracked)
+                {
+                    noteActivity(&_lastWriteSecond);
+                }
+                _zeroCopyPending.push_back(ZeroCopySend{_zeroCopyNextId++, std::move(owner)});
+                _outputBuffer.retrieve(n);
+                return n;
+            }
+            if (n < 0 && errno != ENOBUFS)
+            {
+                *savedErrno = errno;
+                return -1;
+            }
+            // 未完成的通知占满了 optmem, 本次改为普通发送
+        }
+
+        ssize_t n = _outputBuffer.writeFd(_channel->fd(), savedErrno, maxBytes);
+        if (n > 0)
+        {
+            if (_tracked)
+            {
+                noteActivity(&_lastWriteSecond);
+            }
+            _outputBuffer.retrieve(n);
+        }
+        return n;
+    }
+
+    /**
+     * @brief 把输出缓冲的前 maxBytes 字节交给 io_uring 发送, 发送结束时 handleWrite 被调用
+     * @return 交出的字节数
+     */
+    ssize_t TcpConnection::sendThroughRing(size_t maxBytes)
+    {
+        const size_t len = std::min(_outputBuffer.readableBytes(), maxBytes);
+        if (len == _outputBuffer.readableBytes())
+        {
+            // 整个输出缓冲移交, 不拷贝
+            _loop->ioUring()->send(_channel.get(), std::move(_outputBuffer));
+        }
+        else
+        {
+            // 限速时只能交出一部分, 拷贝出来
+            Buffer part(_loop->bufferPool());
+            while (part.readableBytes() < len)
+            {
+                struct iovec iov[16];
+                const size_t count = _outputBuffer.peekSegments(iov, 16, len - part.readableBytes());
+                size_t copied = 0;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    part.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+                    copied += iov[i].iov_len;
+                }
+                _outputBuffer.retrieve(copied);
+            }
+            _loop->ioUring()->send(_channel.get(), std::move(part));
+        }
+
+        if (_tracked)
+        {
+            noteActivity(&_lastWriteSecond);
+        }
+        _ringSending = len;
+        return static_cast<ssize_t>(len);
+    }
+
+    /**
+     * @brief 取回 io_uring 上发送的结果
+     * @return 发送已结束且没有出错
+     */
+    bool TcpConnection::finishRingSend()
+    {
+        int savedErrno = 0;
+        if (!_loop->ioUring()->takeSent(_channel.get(), &savedErrno))
+        {
+            return false;
+        }
+        _ringSending = 0;
+        if (savedErrno != 0)
+        {
+            errno = savedErrno;
+            LOG_ERROR("TcpConnection::handleWrite");
+            reportError(savedErrno);
+            // 之后的数据无法按顺序发出
+            forceClose();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 读取错误队列中的 MSG_ZEROCOPY 完成通知并释放对应的内存
+     *
+     * 完成通知引起的 EPOLLERR 不是错误; 错误队列中的其他错误或 SO_ERROR 仍交给 reportError
+     * @return EPOLLERR 已处理, 返回 false 时按普通错误处理
+     */
+    bool TcpConnection::handleErrorQueue()
+    {
+        if (_zeroCopyThreshold == 0 && _zeroCopyPending.empty())
+        {
+            return false;
+        }
+
+        int error = 0;
+        if (!drainErrorQueue(_channel->fd(), _zeroCopyPending, &_zeroCopyCopied, &error) && error == 0)
+        {
+            return false;
+        }
+        // 完成通知可能与真正的错误同时到达
+        if (error == 0)
+        {
+            error = socketError(_channel->fd());
+        }
+        if (error != 0)
+        {
+            reportError(error);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 读完 fd 的错误队列, 释放 [ee_info, ee_data] 范围内已完成的发送
+     * @param copied 累加内核退回拷贝的完成通知次数
+     * @param error 记录错误队列中第一个不是完成通知的错误
+     * @return 读到了完成通知
+     */
+    bool TcpConnection::drainErrorQueue(int fd, std::deque<ZeroCopySend> &pending, size_t *copied, int *error)
+    {
+        bool notified = false;
+        while (true)
+        {
+            char control[128];
+            struct msghdr msg = {};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof control;
+            if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+            {
+                break; // EAGAIN: 已读完
+            }
+
+            for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+            {
+                if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+                    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+                {
+                    continue;
+                }
+                const struct sock_extended_err *err = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+                if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                {
+                    if (err->ee_errno != 0 && *error == 0)
+                    {
+                        *error = static_cast<int>(err->ee_errno);
+                    }
+                    continue;
+                }
+
+                // TCP 按顺序通知
+                notified = true;
+                if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                {
+                    ++*copied;
+                }
+                while (!pending.empty() &&
+                       static_cast<int32_t>(pending.front().id - err->ee_data) <= 0)
+                {
+                    pending.pop_front();
+                }
+            }
+        }
+        return notified;
+    }
+
+    /**
+     * @brief 连接销毁时仍有未收到完成通知的 MSG_ZEROCOPY 发送, 内核还在引用这些内存
+     *
+     * 持有socket的副本和内存直到完成通知全部到达; 超过 kZeroCopyLingerSeconds 时以 RST 中止连接,
+     * 内核丢弃未发送的数据后再释放内存
+     */
+    class TcpConnection::ZeroCopyLinger : noncopyable, public std::enable_shared_from_this<ZeroCopyLinger>
+    {
+    public:
+        ZeroCopyLinger(EventLoop *loop, int fd, std::deque<ZeroCopySend> pending)
+            : _loop(loop),
+              _fd(fd),
+              _channel(loop, fd),
+              _pending(std::move(pending)),
+              _copied(0)
+        {
+        }
+
+        ~ZeroCopyLinger()
+        {
+            ::close(_fd);
+        }
+
+        void start()
+        {
+            _self = shared_from_this();
+            // 只关心错误队列, 边沿触发避免对端关闭后一直可读
+            _channel.setEdgeTriggered(true);
+            _channel.setReadCallback(std::bind(&ZeroCopyLinger::drain, this));
+            _channel.setCloseCallback(std::bind(&ZeroCopyLinger::drain, this));
+            _channel.setErrorCallback(std::bind(&ZeroCopyLinger::drain, this));
+            _channel.setErrorQueueCallback([this]
+                                           { drain(); return true; });
+            _channel.enableReading();
+            std::weak_ptr<ZeroCopyLinger> weak(_self);
+            _timer = _loop->runAfter(kZeroCopyLingerSeconds, [weak]
+                                     {
+                std::shared_ptr<ZeroCopyLinger> linger = weak.lock();
+                if (linger)
+                {
+                    linger->abort();
+                } });
+            drain();
+        }
+
+    private:
+        void drain()
+        {
+            if (!_self)
+            {
+                return;
+            }
+            int error = 0;
+            TcpConnection::drainErrorQueue(_fd, _pending, &_copied, &error);
+            if (_pending.empty())
+            {
+                _loop->cancel(_timer);
+                finish();
+            }
+        }
+
+        void abort()
+        {
+            LOG_ERROR("TcpConnection::ZeroCopyLinger fd={} - abort with {} zero-copy sends pending", _fd, _pending.size());
+            struct linger lg = {1, 0};
+            ::setsockopt(_fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+            finish();
+        }
+
+        void finish()
+        {
+            _channel.disableAll();
+            _channel.remove();
+            // 可能在 Channel 的回调中, 推迟到本轮之后析构
+            _loop->queueInLoop([self = std::move(_self)] {});
+        }
+
+        EventLoop *_loop;
+        const int _fd;
+        Channel _channel;
+        std::deque<ZeroCopySend> _pending;
+        size_t _copied;
+        TimerId _timer;
+        std::shared_ptr<ZeroCopyLinger> _self; // 完成前持有自身
+    };
+
+    /**
+     * @brief 把未完成的 MSG_ZEROCOPY 发送交给 ZeroCopyLinger, 连接关闭后内存仍保持有效, 只能在loop线程调用
+     */
+    void TcpConnection::lingerZeroCopy()
+    {
+        if (_zeroCopyPending.empty())
+        {
+            return;
+        }
+        handleErrorQueue();
+        if (_zeroCopyPending.empty())
+        {
+            return;
+        }
+
+        int fd = ::dup(_channel->fd());
+        if (fd < 0)
+        {
+            LOG_ERROR("TcpConnection::lingerZeroCopy [{}] - dup error:{}", _name, strerror(errno));
+            return;
+        }
+        // 副本让socket在连接关闭后继续存在, 先发出关闭时本应发送的 FIN
+        ::shutdown(fd, SHUT_WR);
+        auto linger = std::make_shared<ZeroCopyLinger>(_loop, fd, std::move(_zeroCopyPending));
+        _zeroCopyPending.clear();
+        linger->start();
+    }
+
+    void TcpConnection::setZeroCopyThreshold(size_t threshold)
+    {
+        if (_completionIo)
+        {
+            LOG_ERROR("TcpConnection::setZeroCopyThreshold [{}] - already sending through io_uring", _name);
+            return;
+        }
+        if (threshold > 0 && _zeroCopyThreshold == 0)
+        {
+            if (!_socket->setZeroCopy(true))
+            {
+                return;
+            }
+            _outputBuffer.setChained(true);
+        }
+        _zeroCopyThreshold = threshold;
+    }
+
+    void TcpConnection::setEdgeTriggered(bool on)
+    {
+        _channel->setEdgeTriggered(on);
+    }
+
+    void TcpConnection::setChainedOutput(bool on)
+    {
+        _outputBuffer.setChained(on);
+    }
+
+    void TcpConnection::setRecvLowat(int bytes)
+    {
+        if (bytes != _recvLowat)
+        {
+            _socket->setRecvLowat(bytes);
+            _recvLowat = bytes;
+        }
+    }
+
+    void TcpConnection::setNotSentLowat(int bytes)
+    {
+        if (bytes != _notSentLowat)
+        {
+            _socket->setNotSentLowat(bytes);
+            _notSentLowat = bytes;
+        }
+    }
+
+    int TcpConnection::unsentBytes() const
+    {
+        return _socket->unsentBytes();
+    }
+
+    void TcpConnection::shutdown()
+    {
+        if (_state == kConnected)
+        {
+            setState(kDisconnecting);
+            _loop->runInLoop(
+                std::bind(&TcpConnection::shutdownInLoop, this));
+        }
+    }
+
+    void TcpConnection::shutdownInLoop()
+    {
+        // cork 模式下数据可能还在输出缓冲中等待本轮末尾的写出
+        if (!_channel->isWriting() && outputBytes() == 0)
+        {
+            _socket->shutdownWrite();
+        }
+    }
+
+    void TcpConnection::connectEstablished()
+    {
+        setState(kConnected);
+        _channel->tie(shared_from_this());
+        _channel->enableReading();
+        const int64_t now = IdleReaper::secondOf(_loop->now());
+        _lastReadSecond = now;
+        _lastWriteSecond = now;
+        _lastTouchSecond = now;
+
+        _connectionCallback(shared_from_this());
+
+        // 连接回调可能设置零拷贝, 回调返回后再决定是否经由 io_uring 收发; Channel 在本轮之后才提交给 Poller
+        if (_state != kDisconnected && _loop->ioUring() != nullptr && _zeroCopyThreshold == 0)
+        {
+            _completionIo = true;
+            _loop->ioUring()->enableCompletionIo(_channel.get());
+        }
+
+        // 超时设置可能在连接回调中修改, 回调返回后再登记
+        if (_state == kConnected &&
+            (_trackActivity || _idleTimeout > 0 || _readTimeout > 0 || _writeTimeout > 0))
+        {
+            _lruPos = _loop->idleReaper()->add(shared_from_this(), checkTimeouts(now));
+            _tracked = true;
+        }
+    }
+
+    void TcpConnection::setTimeouts(int idleSeconds, int readSeconds, int writeSeconds)
+    {
+        _idleTimeout = idleSeconds;
+        _readTimeout = readSeconds;
+        _writeTimeout = writeSeconds;
+    }
+
+    int64_t TcpConnection::checkTimeouts(int64_t now)
+    {
+        int64_t next = INT64_MAX;
+        const char *expired = nullptr;
+        auto check = [&](int timeout, int64_t last, const char *what)
+        {
+            if (timeout <= 0)
+            {
+                return;
+            }
+            // 时间戳只精确到秒, 多等一秒保证至少空闲了 timeout 秒
+            if (last + timeout < now)
+            {
+                expired = what;
+            }
+            else
+            {
+                next = std::min(next, last + timeout + 1);
+            }
+        };
+        check(_idleTimeout, std::max(_lastReadSecond, _lastWriteSecond), "idle");
+        check(_readTimeout, _lastReadSecond, "read");
+        if (outputBytes() > 0)
+        {
+            check(_writeTimeout, _lastWriteSecond, "write");
+        }
+        else if (_writeTimeout > 0)
+        {
+            // 没有待发数据时写超时不计时, 输出队列变为非空时会刷新 _lastWriteSecond
+            next = std::min(next, now + _writeTimeout + 1);
+        }
+
+        if (expired != nullptr)
+        {
+            LOG_INFO("TcpConnection::checkTimeouts [{}] - {} timeout, close", _name, expired);
+            forceClose();
+            return 0;
+        }
+        return next == INT64_MAX ? 0 : next;
+    }
+
+    /**
+     * @brief 记录读写活动, 每秒最多把连接移到LRU头部一次
+     */
+    void TcpConnection::noteActivity(int64_t *lastSecond)
+    {
+        const int64_t now = IdleReaper::secondOf(_loop->now());
+        *lastSecond = now;
+        if (_lastTouchSecond != now)
+        {
+            _lastTouchSecond = now;
+            _loop->idleReaper()->touch(_lruPos);
+        }
+    }
+
+    void TcpConnection::untrackActivity()
+    {
+        if (_tracked)
+        {
+            _loop->idleReaper()->remove(_lruPos);
+            _tracked = false;
+        }
+    }
+
+    void TcpConnection::forceClose()
+    {
+        if (_state == kConnected || _state == kDisconnecting)
+        {
+            setState(kDisconnecting);
+            _loop->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+        }
+    }
+
+    void TcpConnection::forceCloseInLoop()
+    {
+        if (_state == kConnected || _state == kDisconnecting)
+        {
+            handleClose();
+        }
+    }
+
+    void TcpConnection::connectDestroyed()
+    {
+        if (_state == kConnected)
+        {
+            setState(kDisconnected);
+            _channel->disableAll();
+
+            _connectionCallback(shared_from_this());
+        }
+        untrackActivity();
+        // 还没有结束的 io_uring 发送由 Poller 持有到请求结束
+        _channel->remove();
+        _ringSending = 0;
+        clearFileRegions();
+        // 退出共用令牌桶的排队, 避免已关闭的连接挡住其他连接
+        setSharedSendLimiter(nullptr);
+        lingerZeroCopy();
+
+        // 连接对象可能在其他线程析构, 在loop线程中提前与内存池脱离
+        _inputBuffer.setPool(nullptr);
+        _outputBuffer.setPool(nullptr);
+    }
+
+    void TcpConnection::handleRead(Timestamp receiveTime)
+    {
+        if (_completionIo)
+        {
+            handleRingRead(receiveTime);
+            return;
+        }
+
+        // 水平触发每次事件只读一次; 边沿触发读到EAGAIN为止, 但单次事件最多读kMaxReadsPerEvent次
+        const int maxReads = _channel->edgeTriggered() ? kMaxReadsPerEvent : 1;
+        for (int i = 0; i < maxReads; ++i)
+        {
+            int savedErrno = 0;
+            ssize_t n = _inputBuffer.readFd(_channel->fd(), &savedErrno, &_readSizePredictor);
+            if (n > 0)
+            {
+                if (_tracked)
+                {
+                    noteActivity(&_lastReadSecond);
+                }
+                _messageCallback(shared_from_this(), &_inputBuffer, receiveTime);
+                if (!_channel->isReading())
+                {
+                    return;
+                }
+            }
+            else if (n == 0)
+            {
+                handleClose();
+                return;
+            }
+            else
+            {
+                if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+                {
+                    errno = savedErrno;
+                    LOG_ERROR("TcpConnection::handleRead");
+                    handleError();
+                }
+                return;
+            }
+        }
+
+        if (_channel->edgeTriggered())
+        {
+            // 达到公平性上限时数据可能未读完, 边沿触发不会再次通知, 留到本轮末尾继续读
+            TcpConnectionPtr guardThis(shared_from_this());
+            _loop->queueInLoop([guardThis, receiveTime]
+                               {
+                if (guardThis->_channel->isReading())
+                {
+                    guardThis->handleRead(receiveTime);
+                } });
+        }
+    }
+
+    /**
+     * @brief 取走 io_uring 上已收到的数据, 其后是对端关闭或出错时关闭连接
+     */
+    void TcpConnection::handleRingRead(Timestamp receiveTime)
+    {
+        IoUringPoller *ring = _loop->ioUring();
+        int savedErrno = 0;
+        ssize_t n = -1;
+        // 每次交给回调的数据与 readFd 一次读到的相当; 暂停读(读背压或连接已关闭)后剩下的留在 Poller 中
+        while (_channel->isReading() &&
+               (n = ring->takeReceived(_channel.get(), &_inputBuffer, &savedErrno, BufferPool::kScratchSize)) > 0)
+        {
+            if (_tracked)
+            {
+                noteActivity(&_lastReadSecond);
+            }
+            _messageCallback(shared_from_this(), &_inputBuffer, receiveTime);
+        }
+
+        if (!_channel->isReading())
+        {
+            return;
+        }
+        if (n == 0)
+        {
+            handleClose();
+        }
+        else if (savedErrno != EAGAIN)
+        {
+            errno = savedErrno;
+            LOG_ERROR("TcpConnection::handleRead");
+            reportError(savedErrno);
+            // recv 已经结束, 不会再有事件报告连接断开
+            handleClose();
+        }
+    }
+
+    void TcpConnection::handleWrite()
+    {
+        // io_uring 上的发送结束; 连接已不再写时只取回结果
+        if (_ringSending > 0 && (!finishRingSend() || !_channel->isWriting()))
+        {
+            return;
+        }
+        if (!_channel->isWriting())
+        {
+            LOG_ERROR("Connection fd = {} is down, no more writing", _channel->fd());
+            return;
+        }
+
+        const int maxWrites = _channel->edgeTriggered() ? kMaxWritesPerEvent : 1;
+        for (int i = 0; i < maxWrites; ++i)
+        {
+            int saveErrno = 0;
+            ssize_t n = writeShaped(&saveErrno);
+
+            if (n >= 0)
+            {
+                outputDrained();
+                if (outputBytes() == 0)
+                {
+                    writeCompleted();
+                    return;
+                }
+                if (_ringSending > 0)
+                {
+                    return; // 等待 io_uring 上的发送结束
+                }
+            }
+            else
+            {
+                if (saveErrno != EAGAIN && saveErrno != EWOULDBLOCK)
+                {
+                    LOG_ERROR("TcpConnection::handleWrite");
+                }
+                return;
+            }
+        }
+
+        if (_channel->edgeTriggered())
+        {
+            TcpConnectionPtr guardThis(shared_from_this());
+            _loop->queueInLoop([guardThis]
+                               {
+                if (guardThis->_channel->isWriting())
+                {
+                    guardThis->handleWrite();
+                } });
+        }
+    }
+
+    void TcpConnection::writeCompleted()
+    {
+        _channel->disableWriting();
+        if (_writeCompleteCallback)
+        {
+            _loop->queueInLoop(
+                std::bind(_writeCompleteCallback, shared_from_this()));
+        }
+        if (_state == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+    }
+
+    void TcpConnection::handleClose()
+    {
+        LOG_DEBUG("fd = {} state = {}", _channel->fd(), _state.load());
+        setState(kDisconnected);
+        _channel->disableAll();
+        untrackActivity();
+        if (_backpressurePaused && _backpressureHasSource)
+        {
+            // 本连接不再发送, 不能让来源连接一直暂停
+            resumeBackpressure();
+        }
+
+        TcpConnectionPtr guardThis(shared_from_this());
+        _connectionCallback(guardThis);
+        _closeCallback(guardThis);
+    }
+
+    void TcpConnection::handleError()
+    {
+        reportError(socketError(_channel->fd()));
+    }
+
+    void TcpConnection::reportError(int err)
+    {
         LOG_ERROR("TcpConnection::handleError [{}] - SO_ERROR = {} {}", _name.c_str(), err, strerror(err));
     }
 } // namespace schwi
@@ -3,12 +3,20 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <deque>
+#include <span>
+#include <sys/uio.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #include "base/noncopyable.hpp"
 #include "base/Timestamp.hpp"
 #include "net/Buffer.hpp"
+#include "net/ReadSizePredictor.hpp"
 #include "net/Callback.hpp"
 #include "net/InetAddress.hpp"
+#include "net/IdleReaper.hpp"
+#include "net/TokenBucket.hpp"
 
 namespace schwi
 {
@@ -34,10 +42,123 @@ namespace schwi
         bool connected() const { return _state == kConnected; }
 
         void send(const std::string &message);
-        void send(Buffer *message);
+        void send(Buffer *message); // 取走 message 的全部数据; 在其他线程调用时 message 的内存池不能属于其他loop
+
+        /**
+         * @brief 接管 message 发送, 在其他线程调用时整体移动到loop线程, 中间不拷贝
+         *
+         * 使用内存池的 Buffer 把内存从池中取出一起移走, message 仍属于原内存池, 内存池需属于调用线程。
+         */
+        void send(std::string &&message);
+        void send(Buffer &&message);
+
+        /**
+         * @brief 把多段内存按顺序作为一条消息发送, 输出空闲时直接 writev, 只把没写完的部分放入输出缓冲
+         *
+         * 在其他线程调用时先拷贝数据。
+         */
+        void send(std::span<const iovec> message);
+
+        /**
+         * @brief 同上, 但内存由 owner 持有: 调用方之后不能修改这些内存
+         *
+         * 不会拷贝到字符串再转交loop线程; 链式输出模式下没写完的部分也只持有 owner 不拷贝。
+         */
+        void send(std::span<const iovec> message, std::shared_ptr<const void> owner);
+
+        /**
+         * @brief 发送文件 fd 中从 offset 开始的 length 字节, 用 sendfile 直接从页缓存发送
+         *
+         * 管道用 splice 直接送入socket; socket 等 sendfile 不支持的fd经中转管道 splice, 也不支持时读到内存再写。
+         * 管道和socket忽略 offset, 暂时没有数据时等待其可读, 不会空转。
+         * 与 send 的数据按调用顺序发送, 同样计入高水位并在全部发完后回调 WriteCompleteCallback。
+         * 文件读取出错或提前结束时丢弃之后的全部输出并关闭连接, 对端不会收到错位的数据。
+         * fd 会被复制一份, 调用后即可关闭。
+         */
+        void sendFile(int fd, off_t offset, size_t length);
 
         void shutdown();
 
+        // 以边沿触发方式注册, 需要在connectEstablished之前调用
+        void setEdgeTriggered(bool on);
+
+        // 输出缓冲改用链式分段并以writev发送, 需要在输出缓冲为空时调用(如连接回调中)
+        void setChainedOutput(bool on);
+
+        /**
+         * @brief 输出缓冲中不小于 threshold 字节的分段改用 MSG_ZEROCOPY 发送, 0 表示关闭
+         *
+         * 会把输出缓冲切换为链式模式, 需要在输出缓冲为空时于loop线程中调用(如连接回调中)。
+         * 分段内存在内核的完成通知到达前一直被持有; 只有通过链式 Buffer 交给 send(Buffer*) 的外部内存能省去拷贝。
+         * 设置后连接不经由 io_uring 收发, 所以在 io_uring loop 上只能在连接回调中设置。
+         */
+        void setZeroCopyThreshold(size_t threshold);
+        size_t zeroCopyThreshold() const { return _zeroCopyThreshold; }
+        size_t zeroCopyPending() const { return _zeroCopyPending.size(); } // 等待完成通知的发送次数
+        size_t zeroCopyCopied() const { return _zeroCopyCopied; }          // 内核退回拷贝的完成通知次数(如回环地址)
+
+        // 设置SO_RCVLOWAT, 与当前值相同时不做系统调用, 只能在loop线程中调用
+        void setRecvLowat(int bytes);
+        int recvLowat() const { return _recvLowat; }
+
+        // 分帧编解码器记录输入缓冲开头已确认不含帧边界的字节数, 下次从这里续扫, 只能在loop线程中使用
+        void setFrameScanned(size_t bytes) { _frameScanned = bytes; }
+        size_t frameScanned() const { return _frameScanned; }
+
+        /**
+         * @brief 设置 TCP_NOTSENT_LOWAT: 内核中已写入但未发出的数据低于 bytes 时才可写, 0 表示不限制
+         *
+         * 超出的数据留在用户态的输出缓冲中, 后到的高优先级数据不必排在内核里的大量数据之后。
+         * 只能在loop线程中调用, 与当前值相同时不做系统调用。
+         */
+        void setNotSentLowat(int bytes);
+        int notSentLowat() const { return _notSentLowat; }
+        int unsentBytes() const;    // 内核发送队列中尚未发出的字节数, 失败返回 -1
+        size_t outputBytes() const; // 用户态尚未写入socket的字节数, 包括文件, 只能在loop线程中调用
+
+        /**
+         * @brief 按令牌桶限制本连接的发送速率, bytesPerSecond 不大于 0 表示不限制
+         *
+         * 令牌用完时停止关注可写事件, 由loop的定时器在令牌足够时恢复, 单次写出不超过 burst 字节,
+         * 同一loop上的大流量下载不会长时间占用loop。同时设置 SO_MAX_PACING_RATE 由内核平滑发出。
+         * burst 为 0 时取 0.1 秒的流量(见 TokenBucket)。只能在loop线程或连接建立之前调用。
+         */
+        void setSendRateLimit(double bytesPerSecond, size_t burst = 0);
+        // 与其他连接共用的令牌桶(如 TcpServer 的总带宽), 与本连接自己的限速同时生效
+        void setSharedSendLimiter(std::shared_ptr<TokenBucket> limiter);
+        bool sendPaused() const { return _sendPaused; } // 正在等待令牌
+
+        /**
+         * @brief cork 模式: loop线程中的发送只追加到输出缓冲, 每轮事件处理完后统一写一次socket
+         *
+         * 适合一个请求多次 send 或流水线请求(RESP、HTTP/1.1 pipelining), 减少小报文和系统调用。
+         * 链式输出缓冲一次 writev 写出全部分段。只能在loop线程中调用, 关闭时把已缓存的数据照常写出。
+         */
+        void setCorked(bool on);
+        bool corked() const { return _corked; }
+
+        /**
+         * @brief 是否经由 io_uring 收发: loop 的 Poller 支持基于完成的收发且没有设置零拷贝时, 连接回调返回后开启
+         *
+         * 读由 recv 请求完成, 收到的数据从缓冲环拷入输入缓冲; 写与 cork 模式一样在每轮末尾把输出缓冲整体交给 io_uring,
+         * 同一轮各连接的 SEND 请求在下一次 io_uring_enter 中一起提交, 发送结束前这部分数据仍计入 outputBytes。
+         */
+        bool completionIo() const { return _completionIo; }
+
+        // 暂停/恢复读取: 暂停期间不从socket读数据, 由内核接收窗口向对端施加背压
+        void startRead();
+        void stopRead();
+        bool isReading() const { return _reading; } // 只在loop线程中可靠
+
+        /**
+         * @brief 读背压策略: 本连接待发送的字节数达到 highWaterMark 时暂停 source 的读取, 降到 lowWaterMark 以下时恢复
+         *
+         * source 为空时暂停本连接自己的读取(如回显服务); 代理中传入配对的上游连接, 使每个慢客户端占用的内存有上界。
+         * highWaterMark 为 0 表示关闭, lowWaterMark 不小于 highWaterMark 时取其一半。只能在loop线程中调用,
+         * source 与本连接不在同一个loop时通过 startRead/stopRead 转发。
+         */
+        void setReadBackpressure(size_t highWaterMark, size_t lowWaterMark, const TcpConnectionPtr &source = nullptr);
+
         void setConnectionCallback(const ConnectionCallback &cb)
         {
             _connectionCallback = cb;
@@ -60,6 +181,23 @@ namespace schwi
             _highWaterMark = highWaterMark;
         }
 
+        void forceClose(); // 丢弃未发送的数据直接关闭
+
+        /**
+         * @brief 超时关闭(秒, 0 表示不限制): idle 既没有收到也没有写出数据, read 没有收到数据, write 有待发数据但写不出去
+         *
+         * 以秒为粒度由本loop的 IdleReaper 检查, 实际在超时后的 1~2 秒内强制关闭。需要在连接回调返回之前设置。
+         */
+        void setTimeouts(int idleSeconds, int readSeconds = 0, int writeSeconds = 0);
+        // 加入本loop的LRU链表, 可以在fd将要耗尽时被淘汰, 需要在连接回调返回之前设置
+        void setTrackActivity(bool on) { _trackActivity = on; }
+
+        /**
+         * @brief 由 IdleReaper 调用, 检查各项超时
+         * @return 已超时(连接被强制关闭)或没有超时设置时返回 0, 否则为下一次需要检查的时刻(秒)
+         */
+        int64_t checkTimeouts(int64_t now);
+
         void connectEstablished();
         void connectDestroyed();
 
@@ -74,13 +212,84 @@ namespace schwi
 
         void setState(StateE s) { _state = s; }
         void handleRead(Timestamp receiveTime);
+        void handleRingRead(Timestamp receiveTime);
         void handleWrite();
+        bool finishRingSend();
         void handleClose();
         void handleError();
+        void reportError(int err);
+
+        /**
+         * @brief 输出队列中的一段文件, after 保存在它之后、下一段文件之前发送的内存数据
+         */
+        struct FileRegion
+        {
+            enum Mode
+            {
+                kSendfile, // sendfile 直接从页缓存发送
+                kSplice,   // 源为管道, splice 直接送入socket
+                kPipe,     // splice 经中转管道送入socket
+                kCopy,     // 源不支持 splice, 读到内存再写socket
+            };
+
+            int fd;
+            off_t offset;
+            size_t remaining; // 尚未写入socket的字节数, 包括中转中的部分
+            bool stream;      // 管道或socket, 不能指定偏移
+            Mode mode;
+            int pipe[2];   // kPipe 的中转管道, 用到时创建
+            size_t staged; // 已从源读出、还在中转管道或 copy 中的字节数
+            Buffer copy;   // kCopy 的中转内存
+            Buffer after;
+        };
+
+        /**
+         * @brief 一次 MSG_ZEROCOPY 发送, 在完成通知到达前持有内存
+         */
+        struct ZeroCopySend
+        {
+            uint32_t id;
+            std::shared_ptr<const void> owner;
+        };
+
+        class ZeroCopyLinger; // 连接销毁后继续持有未完成的 MSG_ZEROCOPY 发送, 直到完成通知到达
 
         void sendInLoop(const std::string &message);
+        void sendInLoop(std::string &&message);
+        void sendBufferInLoop(Buffer *message);
         void sendInLoop(const void *message, size_t len);
+        void sendInLoop(const iovec *iov, size_t count, const std::shared_ptr<const void> &owner);
+        void sendInLoop(Buffer *message);
+        ssize_t writeOutput(int *savedErrno, size_t maxBytes = SIZE_MAX);
+        ssize_t sendThroughRing(size_t maxBytes);
+        bool handleErrorQueue();
+        static bool drainErrorQueue(int fd, std::deque<ZeroCopySend> &pending, size_t *copied, int *error);
+        void lingerZeroCopy();
+        void sendFileInLoop(int fd, off_t offset, size_t length);
+        ssize_t writeFileRegion(int *savedErrno, size_t maxBytes = SIZE_MAX);
+        ssize_t stageFileRegion(FileRegion &region, size_t len);
+        void finishFileRegion();
+        void abortOutput();
+        void clearFileRegions();
+        void closeFileRegion(FileRegion &region);
+        void waitForSource();
+        void handleSourceReady();
+        void writeCompleted();
         void shutdownInLoop();
+        void startReadInLoop();
+        void stopReadInLoop();
+        void outputGrew(size_t oldLen, size_t newLen);
+        void outputDrained();
+        void resumeBackpressure();
+        void startWriting();
+        void flushCorked();
+        bool canWriteDirectly() const;
+        ssize_t writeShaped(int *savedErrno);
+        void pauseSending(size_t want);
+        void resumeSending();
+        void forceCloseInLoop();
+        void noteActivity(int64_t *lastSecond);
+        void untrackActivity();
 
         EventLoop *_loop;
         std::string _name;
@@ -99,9 +308,46 @@ namespace schwi
         CloseCallback _closeCallback;
         HighWaterMarkCallback _highWaterMarkCallback;
         size_t _highWaterMark;
+        int _recvLowat;
+        size_t _frameScanned;
+        int _notSentLowat;
+
+        size_t _backpressureHigh; // 0 表示不启用读背压
+        size_t _backpressureLow;
+        std::weak_ptr<TcpConnection> _backpressureSource;
+        bool _backpressureHasSource; // 为 false 时暂停的是本连接
+        bool _backpressurePaused;
+
+        bool _corked;
+        bool _flushScheduled; // 已登记本轮末尾的写出
+        bool _completionIo;   // 经由 io_uring 收发
+        size_t _ringSending;  // 已交给 io_uring 还没有发送结束的字节数
 
+        std::unique_ptr<TokenBucket> _sendLimiter;
+        std::shared_ptr<TokenBucket> _sharedSendLimiter;
+        TokenBucket::Waiter _sharedSendTurn; // 在共用令牌桶中的排队状态
+        bool _sendPaused; // 令牌不足, 等待定时器恢复写
+
+        int _idleTimeout;
+        int _readTimeout;
+        int _writeTimeout;
+        bool _trackActivity;
+        bool _tracked; // 已登记到本loop的 IdleReaper
+        int64_t _lastReadSecond;
+        int64_t _lastWriteSecond;   // 最近一次写出数据, 或输出队列由空变为非空的时刻
+        int64_t _lastTouchSecond;   // 最近一次移到LRU头部的时刻
+        IdleReaper::LruList::iterator _lruPos;
+
+        ReadSizePredictor _readSizePredictor; // 按最近的读取量决定下次为输入缓冲预留的空间
         Buffer _inputBuffer;
         Buffer _outputBuffer;
+        std::deque<FileRegion> _outputFiles; // 输出缓冲之后待发送的文件
+        std::unique_ptr<Channel> _sourceChannel; // 队首文件为暂时没有数据的管道或socket时, 等待其可读
+
+        size_t _zeroCopyThreshold;
+        uint32_t _zeroCopyNextId; // 内核为每次成功的 MSG_ZEROCOPY 发送依次编号
+        std::deque<ZeroCopySend> _zeroCopyPending;
+        size_t _zeroCopyCopied;
     };
 
 } // namespace schwi
@@ -1,7 +1,11 @@
 #include "net/TcpServer.hpp"
 #include "net/TcpConnection.hpp"
+#include "net/TokenBucket.hpp"
 #include "base/base.hpp"
 
+#include <algorithm>
+#include <sys/resource.h>
+
 namespace schwi
 {
     static EventLoop *CheckLoopNotNull(EventLoop *loop)
@@ -13,6 +17,24 @@ namespace schwi
         return loop;
     }
 
+    /**
+     * @brief 在 loops[index] 上淘汰一个最久没有活动的连接, 该loop没有可淘汰的连接时交给下一个loop
+     */
+    static void EvictOnLoops(std::shared_ptr<const std::vector<EventLoop *>> loops, size_t index)
+    {
+        if (index >= loops->size())
+        {
+            return;
+        }
+        EventLoop *loop = (*loops)[index];
+        loop->runInLoop([loops, index, loop]
+                        {
+            if (loop->idleReaper()->evictLeastRecentlyActive(1) == 0)
+            {
+                EvictOnLoops(loops, index + 1);
+            } });
+    }
+
     TcpServer::TcpServer(EventLoop *loop,
                          const InetAddress &listenAddr,
                          const std::string &name,
@@ -27,7 +49,15 @@ namespace schwi
           _writeCompleteCallback(),
           _threadInitCallback(),
           _started(0),
-          _nextConnId(1)
+          _nextConnId(1),
+          _edgeTriggered(false),
+          _connectionSendRate(0),
+          _idleTimeout(0),
+          _readTimeout(0),
+          _writeTimeout(0),
+          _fdLimitRatio(0),
+          _evictFd(0),
+          _evictPending(false)
     {
         _acceptor->setNewConnectionCallback(
             std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
@@ -51,6 +81,39 @@ namespace schwi
         _threadPool->setThreadNum(numThreads);
     }
 
+    void TcpServer::setBusyPoll(int spinMicros, int socketBusyPollMicros)
+    {
+        // 线程数为0时连接都在base loop上, 也需要同样的设置
+        _loop->setBusyPoll(spinMicros, socketBusyPollMicros);
+        _threadPool->setBusyPoll(spinMicros, socketBusyPollMicros);
+    }
+
+    void TcpServer::setEdgeTriggered(bool on)
+    {
+        _edgeTriggered = on;
+        _acceptor->setEdgeTriggered(on);
+    }
+
+    void TcpServer::setSendRateLimit(double perConnection, double total)
+    {
+        _connectionSendRate = perConnection;
+        if (total > 0)
+        {
+            _sendLimiter = std::make_shared<TokenBucket>(total);
+        }
+        else
+        {
+            _sendLimiter.reset();
+        }
+    }
+
+    void TcpServer::setTimeouts(int idleSeconds, int readSeconds, int writeSeconds)
+    {
+        _idleTimeout = idleSeconds;
+        _readTimeout = readSeconds;
+        _writeTimeout = writeSeconds;
+    }
+
     void TcpServer::start()
     {
         LOG_DEBUG("TcpServer::start() _started = {}", _started.load());
@@ -58,6 +121,16 @@ namespace schwi
         {
             _threadPool->start(_threadInitCallback);
 
+            struct rlimit limit;
+            if (_fdLimitRatio > 0 && ::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+            {
+                _evictFd = static_cast<int>(limit.rlim_cur * _fdLimitRatio);
+            }
+            if (_fdLimitRatio > 0)
+            {
+                _acceptor->setFdExhaustedCallback(std::bind(&TcpServer::handleFdExhausted, this));
+            }
+
             _loop->runInLoop(
                 std::bind(&Acceptor::listen, _acceptor.get()));
         }
@@ -93,6 +166,22 @@ namespace schwi
         conn->setConnectionCallback(_connectionCallback);
         conn->setMessageCallback(_messageCallback);
         conn->setWriteCompleteCallback(_writeCompleteCallback);
+        conn->setEdgeTriggered(_edgeTriggered);
+        if (_connectionSendRate > 0)
+        {
+            conn->setSendRateLimit(_connectionSendRate);
+        }
+        conn->setSharedSendLimiter(_sendLimiter);
+        conn->setTimeouts(_idleTimeout, _readTimeout, _writeTimeout);
+        if (_fdLimitRatio > 0)
+        {
+            conn->setTrackActivity(true);
+            // fd按最小可用编号分配, 编号接近上限说明打开的fd数接近上限
+            if (_evictFd > 0 && sockfd >= _evictFd)
+            {
+                evictLeastRecentlyActive();
+            }
+        }
         conn->setCloseCallback(
             std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
         ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
@@ -109,8 +198,32 @@ namespace schwi
         LOG_INFO("TcpServer::removeConnectionInLoop [{}] - connection {}", _name, conn->name());
 
         _connections.erase(conn->name());
+        _evictPending = false;
         EventLoop *ioLoop = conn->getLoop();
         ioLoop->queueInLoop(
             std::bind(&TcpConnection::connectDestroyed, conn));
     }
+
+    /**
+     * @brief 强制关闭所有loop中最久没有活动的连接
+     *
+     * 各loop的LRU只能在各自线程中访问, 按各loop公布的LRU尾部活动时刻从旧到新依次尝试。
+     */
+    void TcpServer::evictLeastRecentlyActive()
+    {
+        auto loops = std::make_shared<std::vector<EventLoop *>>(_threadPool->getAllLoops());
+        std::stable_sort(loops->begin(), loops->end(), [](EventLoop *a, EventLoop *b)
+                         { return a->idleReaper()->oldestActivity() < b->idleReaper()->oldestActivity(); });
+        EvictOnLoops(loops, 0);
+    }
+
+    void TcpServer::handleFdExhausted()
+    {
+        // 水平触发时监听socket在腾出fd之前一直可读, 有连接移除之前只淘汰一次
+        if (!_evictPending)
+        {
+            _evictPending = true;
+            evictLeastRecentlyActive();
+        }
+    }
 } // namespace schwi
@@ -0,0 +1,141 @@
+#include "net/TokenBucket.hpp"
+#include "base/Timestamp.hpp"
+
+#include <algorithm>
+
+namespace schwi
+{
+    TokenBucket::TokenBucket(double bytesPerSecond, size_t burst)
+        : _rate(bytesPerSecond),
+          _burst(burst > 0 ? burst : std::max(static_cast<size_t>(bytesPerSecond / 10), kMinDefaultBurst)),
+          _tokens(static_cast<double>(_burst)),
+          _last(MonoTime::now()),
+          _users(0)
+    {
+    }
+
+    void TokenBucket::refill(MonoTime now)
+    {
+        if (now <= _last)
+        {
+            return;
+        }
+        double elapsed = static_cast<double>(now.microseconds() - _last.microseconds()) / Timestamp::kMicroSecondsPerSecond;
+        _tokens = std::min(_tokens + elapsed * _rate, static_cast<double>(_burst));
+        _last = now;
+    }
+
+    size_t TokenBucket::acquire(size_t want, MonoTime now, size_t atLeast, Waiter *waiter)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refill(now);
+        if (waiter != nullptr)
+        {
+            skipStalledHead(waiter, now);
+        }
+        size_t granted = std::min(want, static_cast<size_t>(_tokens));
+        bool blocked = waiter != nullptr && !_waiters.empty() && _waiters.front() != waiter;
+        if (blocked || granted < atLeast)
+        {
+            if (waiter != nullptr && !waiter->queued)
+            {
+                waiter->queued = true;
+                waiter->need = std::max<size_t>(atLeast, 1);
+                _waiters.push_back(waiter);
+                if (_waiters.size() == 1)
+                {
+                    startTurn(waiter, now);
+                }
+            }
+            return 0;
+        }
+
+        if (waiter != nullptr && waiter->queued)
+        {
+            // 只有队首能走到这里
+            waiter->queued = false;
+            _waiters.pop_front();
+            if (!_waiters.empty())
+            {
+                startTurn(_waiters.front(), now);
+            }
+        }
+        _tokens -= static_cast<double>(granted);
+        return granted;
+    }
+
+    /**
+     * @brief waiter 成为队首: 令牌最迟在 need / rate 秒后够用, 之后再给它一个同样长的周期回来取
+     */
+    void TokenBucket::startTurn(Waiter *waiter, MonoTime now)
+    {
+        waiter->turnDeadline = addTime(now, 2 * static_cast<double>(waiter->need) / _rate);
+    }
+
+    /**
+     * @brief 队首超过期限仍没有回来取令牌时让出位置, 它之后再来会重新排到队尾
+     */
+    void TokenBucket::skipStalledHead(const Waiter *caller, MonoTime now)
+    {
+        if (_waiters.empty() || _waiters.front() == caller || now <= _waiters.front()->turnDeadline)
+        {
+            return;
+        }
+        _waiters.front()->queued = false;
+        _waiters.pop_front();
+        if (!_waiters.empty())
+        {
+            startTurn(_waiters.front(), now);
+        }
+    }
+
+    void TokenBucket::removeUser(Waiter *waiter)
+    {
+        _users.fetch_sub(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (waiter->queued)
+        {
+            waiter->queued = false;
+            auto it = std::find(_waiters.begin(), _waiters.end(), waiter);
+            bool head = it == _waiters.begin();
+            _waiters.erase(it);
+            if (head && !_waiters.empty())
+            {
+                startTurn(_waiters.front(), MonoTime::now());
+            }
+        }
+    }
+
+    size_t TokenBucket::share() const
+    {
+        int users = _users.load(std::memory_order_relaxed);
+        return users > 1 ? _burst / users : _burst;
+    }
+
+    void TokenBucket::giveBack(size_t n)
+    {
+        if (n == 0)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tokens = std::min(_tokens + static_cast<double>(n), static_cast<double>(_burst));
+    }
+
+    double TokenBucket::delay(size_t n, MonoTime now, const Waiter *waiter)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        refill(now);
+        double need = static_cast<double>(std::min(n, _burst));
+        if (waiter != nullptr)
+        {
+            // 排在第 k 位时要等前面 k 个人先取走令牌
+            size_t ahead = waiter->queued
+                               ? std::find(_waiters.begin(), _waiters.end(), waiter) - _waiters.begin()
+                               : _waiters.size();
+            need += static_cast<double>(ahead) * need;
+        }
+        double missing = need - _tokens;
+        return missing > 0 ? missing / _rate : 0.0;
+    }
+} // namespace schwi
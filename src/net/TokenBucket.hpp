@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+#include "base/noncopyable.hpp"
+#include "base/MonoTime.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 令牌桶限速器, 按字节计数, 可被多个loop线程的连接共用(如整个 TcpServer 的总带宽)
+     *
+     * 令牌以 rate 字节/秒的速度补充, 最多积累 burst 个。发送前用 acquire 取得本次可写的字节数,
+     * 实际没写出的部分用 giveBack 归还。
+     *
+     * 多个使用者共用时各自用 addUser/removeUser 登记: 每次最多取 share() 个令牌,
+     * 令牌不足的使用者按先后排队, 队首取到令牌之前其他人都取不到, 避免大流量连接独占。
+     * 队首在令牌够用后一个补充周期内没有回来取(如连接被背压或 cork 暂停), 视为放弃, 轮到下一个。
+     */
+    class TokenBucket : noncopyable
+    {
+    public:
+        static constexpr size_t kMinDefaultBurst = 16 * 1024;
+
+        // 使用者的排队状态, 由令牌桶维护
+        struct Waiter
+        {
+            bool queued = false;
+            size_t need = 0;       // 排队时至少需要的令牌数
+            MonoTime turnDeadline; // 成为队首后最迟回来取令牌的时间
+        };
+
+        // burst 为 0 时取 0.1 秒的流量, 至少 kMinDefaultBurst
+        explicit TokenBucket(double bytesPerSecond, size_t burst = 0);
+
+        double rate() const { return _rate; }
+        size_t burst() const { return _burst; }
+
+        /**
+         * @brief 取走最多 want 个令牌
+         * @param atLeast 令牌不足该数量时一个都不取
+         * @param waiter 非空时参与排队: 令牌不足时排到队尾, 前面还有人排队时取不到令牌
+         * @return 实际取得的令牌数, 令牌不足时为 0
+         */
+        size_t acquire(size_t want, MonoTime now, size_t atLeast = 0, Waiter *waiter = nullptr);
+        void giveBack(size_t n);
+
+        void addUser() { _users.fetch_add(1, std::memory_order_relaxed); }
+        void removeUser(Waiter *waiter); // 注销使用者, 同时退出排队
+        size_t share() const;            // 每个使用者单次最多取走的令牌数: burst 按使用者数平分
+
+        /**
+         * @brief 桶中积累到 n 个令牌还需等待的秒数
+         * @param waiter 非空时按其排队位置计算: 前面每个人各取走 n 个令牌后才轮到它
+         */
+        double delay(size_t n, MonoTime now, const Waiter *waiter = nullptr);
+
+    private:
+        void refill(MonoTime now);
+        void startTurn(Waiter *waiter, MonoTime now);
+        void skipStalledHead(const Waiter *caller, MonoTime now);
+
+        const double _rate;
+        const size_t _burst;
+        std::mutex _mutex;
+        double _tokens;
+        MonoTime _last; // 上次补充令牌的时间
+        std::deque<Waiter *> _waiters;
+        std::atomic_int _users;
+    };
+} // namespace schwi
@@ -0,0 +1,88 @@
+#include "net/codec/DelimiterCodec.hpp"
+#include "net/Buffer.hpp"
+#include "base/ByteSearch.hpp"
+#include "base/base.hpp"
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+
+namespace schwi
+{
+    DelimiterCodec::DelimiterCodec(const FrameCallback &cb,
+                                   std::string delimiter,
+                                   size_t maxFrameLength)
+        : FrameCodec(cb, maxFrameLength),
+          _delimiter(std::move(delimiter))
+    {
+        if (_delimiter.empty())
+        {
+            // 查找分隔符时按 end - size + 1 计算查找范围, 空分隔符会越界
+            LOG_ERROR("DelimiterCodec - empty delimiter");
+            abort();
+        }
+    }
+
+    bool DelimiterCodec::envelope(size_t payloadLength, Envelope *env) const
+    {
+        if (payloadLength > _maxFrameLength)
+        {
+            return false;
+        }
+        env->headerLength = 0;
+        env->trailer = _delimiter;
+        return true;
+    }
+
+    FrameCodec::DecodeResult DelimiterCodec::decode(const char *data, size_t len, Frame *frame, size_t *scanned) const
+    {
+        const char *end = data + len;
+        const char *found = find(data + std::min(*scanned, len), end);
+        if (found == end)
+        {
+            // 只有最后 delimiter.size() - 1 个字节可能是未收全的分隔符, 下次从它们开始查找
+            const size_t tail = _delimiter.size() - 1;
+            *scanned = len > tail ? len - tail : 0;
+            return len >= _maxFrameLength + _delimiter.size() ? kError : kIncomplete;
+        }
+        size_t length = found - data;
+        if (length > _maxFrameLength)
+        {
+            return kError;
+        }
+        *frame = Frame{0, length, _delimiter.size()};
+        return kComplete;
+    }
+
+    const char *DelimiterCodec::find(const char *begin, const char *end) const
+    {
+        const size_t n = _delimiter.size();
+        if (n == 1)
+        {
+            return ByteSearch::findByte(begin, end, _delimiter[0]);
+        }
+        if (n == 2 && _delimiter[0] == '\r' && _delimiter[1] == '\n')
+        {
+            return ByteSearch::findCRLF(begin, end);
+        }
+
+        // 先找首字节再比较其余部分
+        const char *p = begin;
+        while (end - p >= static_cast<ptrdiff_t>(n))
+        {
+            p = ByteSearch::findByte(p, end - n + 1, _delimiter[0]);
+            if (p == end - n + 1)
+            {
+                break;
+            }
+            if (::memcmp(p + 1, _delimiter.data() + 1, n - 1) == 0)
+            {
+                return p;
+            }
+            ++p;
+        }
+        return end;
+    }
+} // namespace schwi
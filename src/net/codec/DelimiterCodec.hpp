@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+#include "net/codec/FrameCodec.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 分隔符分帧: 内容 + 分隔符, 默认按 "\r\n" 分行, 回调的帧内容不包括分隔符
+     *
+     * 帧长度在分隔符到达前未知, 因此不会设置 SO_RCVLOWAT。
+     */
+    class DelimiterCodec : public FrameCodec
+    {
+    public:
+        static constexpr size_t kDefaultMaxLineLength = 64 * 1024;
+
+        DelimiterCodec(const FrameCallback &cb,
+                       std::string delimiter = "\r\n",
+                       size_t maxFrameLength = kDefaultMaxLineLength);
+
+        const std::string &delimiter() const { return _delimiter; }
+
+    protected:
+        bool envelope(size_t payloadLength, Envelope *env) const override;
+        DecodeResult decode(const char *data, size_t len, Frame *frame, size_t *scanned) const override;
+
+    private:
+        const char *find(const char *begin, const char *end) const;
+
+        const std::string _delimiter;
+    };
+} // namespace schwi
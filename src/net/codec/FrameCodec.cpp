@@ -0,0 +1,99 @@
+#include "net/codec/FrameCodec.hpp"
+#include "net/TcpConnection.hpp"
+#include "net/Buffer.hpp"
+#include "base/base.hpp"
+
+namespace schwi
+{
+    FrameCodec::FrameCodec(const FrameCallback &cb, size_t maxFrameLength)
+        : _maxFrameLength(maxFrameLength),
+          _frameCallback(cb),
+          _recvLowatEnabled(true)
+    {
+    }
+
+    void FrameCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+    {
+        while (conn->connected())
+        {
+            Frame frame{0, 0, 0};
+            size_t scanned = conn->frameScanned();
+            DecodeResult result = decode(buf->peek(), buf->readableBytes(), &frame, &scanned);
+            if (result == kComplete)
+            {
+                conn->setFrameScanned(0);
+                _frameCallback(conn, std::string_view(buf->peek() + frame.headerLength, frame.payloadLength), receiveTime);
+                buf->retrieve(frame.totalLength());
+            }
+            else if (result == kIncomplete)
+            {
+                conn->setFrameScanned(scanned);
+                size_t total = frame.totalLength();
+                updateRecvLowat(conn, total > buf->readableBytes() ? total - buf->readableBytes() : 0);
+                return;
+            }
+            else
+            {
+                LOG_ERROR("FrameCodec::onMessage [{}] - invalid frame or frame exceeds {} bytes",
+                          conn->name(), _maxFrameLength);
+                buf->retrieveAll();
+                conn->setFrameScanned(0);
+                conn->shutdown();
+                return;
+            }
+        }
+    }
+
+    void FrameCodec::send(const TcpConnectionPtr &conn, std::string_view payload) const
+    {
+        Envelope env;
+        if (!envelope(payload.size(), &env))
+        {
+            LOG_ERROR("FrameCodec::send [{}] - frame of {} bytes exceeds {} bytes",
+                      conn->name(), payload.size(), _maxFrameLength);
+            return;
+        }
+        iovec iov[3];
+        size_t count = 0;
+        if (env.headerLength > 0)
+        {
+            iov[count++] = iovec{env.header, env.headerLength};
+        }
+        iov[count++] = iovec{const_cast<char *>(payload.data()), payload.size()};
+        if (!env.trailer.empty())
+        {
+            iov[count++] = iovec{const_cast<char *>(env.trailer.data()), env.trailer.size()};
+        }
+        conn->send(std::span<const iovec>(iov, count));
+    }
+
+    bool FrameCodec::encode(Buffer *buf) const
+    {
+        Envelope env;
+        if (!envelope(buf->readableBytes(), &env))
+        {
+            return false;
+        }
+        if (env.headerLength > 0)
+        {
+            buf->prepend(env.header, env.headerLength);
+        }
+        buf->append(env.trailer.data(), env.trailer.size());
+        return true;
+    }
+
+    void FrameCodec::updateRecvLowat(const TcpConnectionPtr &conn, size_t missing) const
+    {
+        if (!_recvLowatEnabled)
+        {
+            return;
+        }
+        // 缺得不多时恢复默认值, 避免小消息频繁设置
+        int lowat = 1;
+        if (missing > kRecvLowatThreshold)
+        {
+            lowat = missing < static_cast<size_t>(kMaxRecvLowat) ? static_cast<int>(missing) : kMaxRecvLowat;
+        }
+        conn->setRecvLowat(lowat);
+    }
+} // namespace schwi
@@ -0,0 +1,66 @@
+#include "net/codec/LengthFieldCodec.hpp"
+#include "net/Buffer.hpp"
+#include "base/base.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace schwi
+{
+    LengthFieldCodec::LengthFieldCodec(const FrameCallback &cb,
+                                       int lengthFieldWidth,
+                                       Endian endian,
+                                       size_t maxFrameLength)
+        : FrameCodec(cb, maxFrameLength),
+          _width(lengthFieldWidth),
+          _endian(endian)
+    {
+        if (_width != 1 && _width != 2 && _width != 4 && _width != 8)
+        {
+            // 帧头按不超过8字节的定长数组编解码, 不能带着非法宽度继续
+            LOG_ERROR("LengthFieldCodec - invalid length field width {}", _width);
+            abort();
+        }
+    }
+
+    bool LengthFieldCodec::envelope(size_t payloadLength, Envelope *env) const
+    {
+        uint64_t length = payloadLength;
+        if (length > _maxFrameLength || (_width < 8 && length >> (8 * _width) != 0))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < _width; ++i)
+        {
+            int shift = _endian == kBigEndian ? 8 * (_width - 1 - i) : 8 * i;
+            env->header[i] = static_cast<unsigned char>(length >> shift);
+        }
+        env->headerLength = _width;
+        env->trailer = std::string_view();
+        return true;
+    }
+
+    FrameCodec::DecodeResult LengthFieldCodec::decode(const char *data, size_t len, Frame *frame, size_t *) const
+    {
+        if (len < static_cast<size_t>(_width))
+        {
+            return kIncomplete;
+        }
+
+        const unsigned char *header = reinterpret_cast<const unsigned char *>(data);
+        uint64_t length = 0;
+        for (int i = 0; i < _width; ++i)
+        {
+            int shift = _endian == kBigEndian ? 8 * (_width - 1 - i) : 8 * i;
+            length |= static_cast<uint64_t>(header[i]) << shift;
+        }
+        if (length > _maxFrameLength)
+        {
+            return kError;
+        }
+
+        *frame = Frame{static_cast<size_t>(_width), static_cast<size_t>(length), 0};
+        return len >= frame->totalLength() ? kComplete : kIncomplete;
+    }
+} // namespace schwi
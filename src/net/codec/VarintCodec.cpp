@@ -0,0 +1,60 @@
+#include "net/codec/VarintCodec.hpp"
+#include "net/Buffer.hpp"
+
+#include <stdint.h>
+
+namespace schwi
+{
+    VarintCodec::VarintCodec(const FrameCallback &cb, size_t maxFrameLength)
+        : FrameCodec(cb, maxFrameLength)
+    {
+    }
+
+    bool VarintCodec::envelope(size_t payloadLength, Envelope *env) const
+    {
+        uint64_t length = payloadLength;
+        if (length > _maxFrameLength || length >> (7 * kMaxVarintLength) != 0)
+        {
+            return false;
+        }
+
+        int n = 0;
+        do
+        {
+            env->header[n] = static_cast<unsigned char>(length & 0x7f);
+            length >>= 7;
+            if (length != 0)
+            {
+                env->header[n] |= 0x80;
+            }
+            ++n;
+        } while (length != 0);
+        env->headerLength = n;
+        env->trailer = std::string_view();
+        return true;
+    }
+
+    FrameCodec::DecodeResult VarintCodec::decode(const char *data, size_t len, Frame *frame, size_t *) const
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+        uint64_t length = 0;
+        for (int i = 0; i < kMaxVarintLength; ++i)
+        {
+            if (static_cast<size_t>(i) >= len)
+            {
+                return kIncomplete;
+            }
+            length |= static_cast<uint64_t>(p[i] & 0x7f) << (7 * i);
+            if ((p[i] & 0x80) == 0)
+            {
+                if (length > _maxFrameLength)
+                {
+                    return kError;
+                }
+                *frame = Frame{static_cast<size_t>(i + 1), static_cast<size_t>(length), 0};
+                return len >= frame->totalLength() ? kComplete : kIncomplete;
+            }
+        }
+        return kError; // 长度头超过8字节
+    }
+} // namespace schwi
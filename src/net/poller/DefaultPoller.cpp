@@ -1,12 +1,21 @@
 #include "net/poller/Poller.hpp"
 #include "net/poller/EpollPoller.hpp"
+#include "net/poller/IoUringPoller.hpp"
+#include "net/EventLoop.hpp"
 
 #include <stdlib.h>
 
 namespace schwi
 {
-    Poller *Poller::newDefaultPoller(EventLoop *loop)
+    Poller *Poller::newDefaultPoller(EventLoop *loop, PollerBackend backend)
     {
+        // 没有指定时可以用环境变量切换, 不需要修改代码
+        const bool ioUring = backend == PollerBackend::kIoUring ||
+                             (backend == PollerBackend::kDefault && ::getenv("TINY_NETWORK_USE_IO_URING"));
+        if (ioUring && IoUringPoller::available())
+        {
+            return new IoUringPoller(loop);
+        }
         return new EpollPoller(loop);
     }
 } // namespace schwi
\ No newline at end of file
@@ -68,15 +68,15 @@ namespace schwi
 
     void EpollPoller::updateChannel(Channel *channel)
     {
-        const int index = channel->index();
-        if (index == kNew || index == kDeleted)
+        ChannelSlot &entry = slot(channel->fd());
+        const int state = entry.state;
+        if (state == kNew || state == kDeleted)
         {
-            if (index == kNew)
+            if (state == kNew)
             {
-                int fd = channel->fd();
-                _channels[fd] = channel;
+                entry.channel = channel;
             }
-            channel->set_index(kAdded);
+            entry.state = kAdded;
             update(EPOLL_CTL_ADD, channel);
         }
         else
@@ -84,7 +84,7 @@ namespace schwi
             if (channel->isNoneEvent())
             {
                 update(EPOLL_CTL_DEL, channel);
-                channel->set_index(kDeleted);
+                entry.state = kDeleted;
             }
             else
             {
@@ -95,13 +95,12 @@ namespace schwi
 
     void EpollPoller::removeChannel(Channel *channel)
     {
-        int fd = channel->fd();
-        _channels.erase(fd);
-        if (channel->index() == kAdded)
+        ChannelSlot &entry = slot(channel->fd());
+        if (entry.state == kAdded)
         {
             update(EPOLL_CTL_DEL, channel);
         }
-        channel->set_index(kNew);
+        entry = ChannelSlot();
     }
 
     void EpollPoller::update(int operation, Channel *channel)
@@ -110,7 +109,7 @@ namespace schwi
         bzero(&event, sizeof event);
 
         int fd = channel->fd();
-        event.events = channel->events();
+        event.events = channel->interest();
         event.data.fd = fd;
         event.data.ptr = channel;
 
@@ -0,0 +1,889 @@
+#include "net/poller/IoUringPoller.hpp"
+#include "base/base.hpp"
+
+#include <algorithm>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+namespace schwi
+{
+    const int kAdded = 1;
+
+    // 不需要处理完成事件的请求(取消、归还缓冲)的 user_data, 低两位为 3 所以不会与 POLL_ADD/recv/SEND 的 tag 冲突
+    const uint64_t kCancelTag = UINT64_MAX;
+
+    static int ioUringSetup(unsigned entries, struct io_uring_params *params)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    static int ioUringEnter(int ringfd, unsigned toSubmit, unsigned minComplete,
+                            unsigned flags, void *arg, size_t argsz)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ringfd, toSubmit, minComplete, flags, arg, argsz));
+    }
+
+    static int ioUringRegister(int ringfd, unsigned opcode, void *arg, unsigned nrArgs)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_register, ringfd, opcode, arg, nrArgs));
+    }
+
+    bool IoUringPoller::available()
+    {
+        static const bool supported = []
+        {
+            struct io_uring_params params;
+            bzero(&params, sizeof params);
+            int fd = ioUringSetup(4, &params);
+            if (fd < 0)
+            {
+                return false;
+            }
+            ::close(fd);
+            return (params.features & IORING_FEAT_EXT_ARG) != 0;
+        }();
+        return supported;
+    }
+
+    IoUringPoller::IoUringPoller(EventLoop *loop)
+        : Poller(loop),
+          _ringfd(-1),
+          _sqEntries(0),
+          _cqEntries(0),
+          _sqRing(nullptr),
+          _sqRingSize(0),
+          _cqRing(nullptr),
+          _cqRingSize(0),
+          _sqes(nullptr),
+          _sqesSize(0),
+          _sqLocalTail(0),
+          _nextGeneration(0),
+          _multishot(false),
+          _armedPolls(0),
+          _bufferRing(nullptr),
+          _recvBuffers(nullptr),
+          _bufferTail(0),
+          _provideBuffers(false),
+          _recvMultishot(true),
+          _submittedRecvs(0),
+          _submittedSends(0)
+    {
+        setupRing();
+    }
+
+    IoUringPoller::~IoUringPoller()
+    {
+        if (_sqes != nullptr)
+        {
+            ::munmap(_sqes, _sqesSize);
+        }
+        if (_cqRing != nullptr && _cqRing != _sqRing)
+        {
+            ::munmap(_cqRing, _cqRingSize);
+        }
+        if (_sqRing != nullptr)
+        {
+            ::munmap(_sqRing, _sqRingSize);
+        }
+        ::close(_ringfd);
+        // 关闭 ring 后内核不再从缓冲环取内存
+        if (_bufferRing != nullptr)
+        {
+            ::munmap(_bufferRing, kRecvBuffers * sizeof(struct io_uring_buf));
+        }
+        if (_recvBuffers != nullptr)
+        {
+            ::munmap(_recvBuffers, kRecvBuffers * kRecvBufferSize);
+        }
+    }
+
+    void IoUringPoller::setupRing()
+    {
+        struct io_uring_params params;
+        bzero(&params, sizeof params);
+
+        _ringfd = ioUringSetup(kRingEntries, &params);
+        if (_ringfd < 0)
+        {
+            LOG_FATAL("IoUringPoller::setupRing() io_uring_setup error {}", strerror(errno));
+            return;
+        }
+
+        _sqEntries = params.sq_entries;
+        _cqEntries = params.cq_entries;
+        _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+        const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap)
+        {
+            _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+        }
+
+        _sqRing = ::mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_SQ_RING);
+        if (_sqRing == MAP_FAILED)
+        {
+            _sqRing = nullptr;
+            LOG_FATAL("IoUringPoller::setupRing() mmap sq ring error {}", strerror(errno));
+            return;
+        }
+
+        if (singleMmap)
+        {
+            _cqRing = _sqRing;
+        }
+        else
+        {
+            _cqRing = ::mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_CQ_RING);
+            if (_cqRing == MAP_FAILED)
+            {
+                _cqRing = nullptr;
+                LOG_FATAL("IoUringPoller::setupRing() mmap cq ring error {}", strerror(errno));
+                return;
+            }
+        }
+
+        _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        void *sqes = ::mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, _ringfd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            LOG_FATAL("IoUringPoller::setupRing() mmap sqes error {}", strerror(errno));
+            return;
+        }
+        _sqes = static_cast<struct io_uring_sqe *>(sqes);
+
+        char *sq = static_cast<char *>(_sqRing);
+        _sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        _sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        _sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        _sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        char *cq = static_cast<char *>(_cqRing);
+        _cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        _cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        _sqLocalTail = *_sqTail;
+        // IORING_POLL_ADD_MULTI 与 IORING_FEAT_RSRC_TAGS 同在 5.13 加入
+        _multishot = (params.features & IORING_FEAT_RSRC_TAGS) != 0;
+        LOG_DEBUG("IoUringPoller created ringfd = {} sq = {} cq = {}", _ringfd, _sqEntries, _cqEntries);
+        setupBufferRing();
+    }
+
+    void IoUringPoller::setupBufferRing()
+    {
+        // 接收缓冲只在用到时才占用物理内存
+        void *buffers = ::mmap(nullptr, kRecvBuffers * kRecvBufferSize, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffers == MAP_FAILED)
+        {
+            LOG_ERROR("IoUringPoller::setupBufferRing() mmap buffers error {}", strerror(errno));
+            return;
+        }
+        _recvBuffers = static_cast<char *>(buffers);
+
+        if (!registerBufferRing() && !_provideBuffers)
+        {
+            // 5.19 之前的内核没有提供缓冲环, 只做就绪通知
+            ::munmap(_recvBuffers, kRecvBuffers * kRecvBufferSize);
+            _recvBuffers = nullptr;
+            return;
+        }
+        for (unsigned bid = 0; bid < kRecvBuffers; ++bid)
+        {
+            recycleBuffer(static_cast<uint16_t>(bid));
+        }
+        publishBuffers();
+    }
+
+    bool IoUringPoller::registerBufferRing()
+    {
+        const size_t ringSize = kRecvBuffers * sizeof(struct io_uring_buf);
+        void *ring = ::mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED)
+        {
+            LOG_ERROR("IoUringPoller::registerBufferRing() mmap ring error {}", strerror(errno));
+            return false;
+        }
+
+        struct io_uring_buf_reg reg;
+        bzero(&reg, sizeof reg);
+        reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+        reg.ring_entries = kRecvBuffers;
+        reg.bgid = kBufferGroup;
+        if (ioUringRegister(_ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            LOG_DEBUG("IoUringPoller::registerBufferRing() register error {}", strerror(errno));
+            ::munmap(ring, ringSize);
+            return false;
+        }
+
+        // 先放一个缓冲试收一次, 之后再放入全部缓冲
+        _bufferRing = static_cast<struct io_uring_buf_ring *>(ring);
+        recycleBuffer(0);
+        publishBuffers();
+        if (probeBufferRing())
+        {
+            return true;
+        }
+
+        // 有的内核注册成功却取不到缓冲环中的内存, 改用 PROVIDE_BUFFERS 把同一组缓冲交给内核
+        LOG_DEBUG("IoUringPoller::registerBufferRing() buffer ring unusable, fall back to PROVIDE_BUFFERS");
+        ioUringRegister(_ringfd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        ::munmap(ring, ringSize);
+        _bufferRing = nullptr;
+        _bufferTail = 0;
+        _provideBuffers = true;
+        return false;
+    }
+
+    /**
+     * @brief 在 socketpair 上以缓冲组收一个字节, 确认内核确实从缓冲环取到了内存
+     */
+    bool IoUringPoller::probeBufferRing()
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+        {
+            return false;
+        }
+
+        bool received = false;
+        const char byte = 0;
+        if (::write(fds[1], &byte, 1) == 1)
+        {
+            struct io_uring_sqe *sqe = getSqe();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = fds[0];
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = kBufferGroup;
+            sqe->user_data = kCancelTag;
+
+            const unsigned head = *_cqHead;
+            if (submitAndWait(-1) >= 0 && head != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE))
+            {
+                const struct io_uring_cqe *cqe = &_cqes[head & *_cqMask];
+                received = cqe->res == 1 && (cqe->flags & IORING_CQE_F_BUFFER) != 0;
+                __atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+            }
+        }
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return received;
+    }
+
+    Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+    {
+        for (int fd : _pendingArms)
+        {
+            PollState &state = _states[fd];
+            if (state.pendingArm)
+            {
+                state.pendingArm = false;
+                applyInterest(fd, state);
+            }
+        }
+        _pendingArms.clear();
+
+        // 恢复关注读时还有未取走的数据, 不等待新的完成事件
+        int ret = submitAndWait(_activeFds.empty() ? timeoutMs : 0);
+        Timestamp now(Timestamp::now());
+        if (ret < 0 && errno != ETIME && errno != EINTR)
+        {
+            LOG_ERROR("IoUringPoller::poll() io_uring_enter error {}", strerror(errno));
+        }
+
+        size_t numEvents = activeChannels->size();
+        fillActiveChannels(activeChannels);
+        numEvents = activeChannels->size() - numEvents;
+        if (numEvents > 0)
+        {
+            LOG_DEBUG("IoUringPoller::poll() numEvents = {}", numEvents);
+        }
+        else
+        {
+            LOG_DEBUG("timeout!");
+        }
+        return now;
+    }
+
+    int IoUringPoller::submitAndWait(int timeoutMs)
+    {
+        unsigned toSubmit = _sqLocalTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+        __atomic_store_n(_sqTail, _sqLocalTail, __ATOMIC_RELEASE);
+
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        bzero(&ts, sizeof ts);
+        bzero(&arg, sizeof arg);
+        arg.sigmask_sz = _NSIG / 8;
+        if (timeoutMs >= 0)
+        {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+
+        return ioUringEnter(_ringfd, toSubmit, 1,
+                            IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                            &arg, sizeof arg);
+    }
+
+    void IoUringPoller::fillActiveChannels(ChannelList *activeChannels)
+    {
+        unsigned head = *_cqHead;
+        const unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; ++head)
+        {
+            const struct io_uring_cqe *cqe = &_cqes[head & *_cqMask];
+            const uint64_t tag = cqe->user_data;
+            if (tag == kCancelTag)
+            {
+                continue;
+            }
+
+            const int fd = static_cast<int>(tag >> 32);
+            PollState *state = static_cast<size_t>(fd) < _states.size() ? &_states[fd] : nullptr;
+            CompletionState *completion = state != nullptr ? state->completion.get() : nullptr;
+            switch (static_cast<Op>(tag & 3))
+            {
+            case kPollOp:
+                // 已被取消或fd已被复用时丢弃过期的完成事件
+                if (state != nullptr && state->tag == tag)
+                {
+                    handlePollCompletion(fd, *state, cqe);
+                }
+                break;
+            case kRecvOp:
+                if (completion != nullptr && completion->recvTag == tag)
+                {
+                    handleRecvCompletion(fd, *state, cqe);
+                }
+                else if (cqe->flags & IORING_CQE_F_BUFFER)
+                {
+                    // Channel已移除, 取消生效前收到的数据直接丢弃
+                    recycleBuffer(static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+                }
+                break;
+            case kSendOp:
+                if (completion != nullptr && completion->sendTag == tag && completion->sendInflight > 0)
+                {
+                    handleSendCompletion(fd, *state, cqe);
+                }
+                else
+                {
+                    auto it = _orphanSends.find(tag);
+                    if (it != _orphanSends.end() && --it->second->sendInflight == 0)
+                    {
+                        _orphanSends.erase(it);
+                    }
+                }
+                break;
+            }
+        }
+
+        __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+        publishBuffers();
+
+        for (int fd : _activeFds)
+        {
+            PollState &state = _states[fd];
+            Channel *channel = _channels[fd].channel;
+            LOG_DEBUG("IoUringPoller::fillActiveChannels() fd = {} events={}", fd, state.revents);
+            channel->set_revents(state.revents);
+            activeChannels->push_back(channel);
+            state.revents = 0;
+        }
+        _activeFds.clear();
+    }
+
+    void IoUringPoller::handlePollCompletion(int fd, PollState &state, const io_uring_cqe *cqe)
+    {
+        // 多次触发的请求带 F_MORE 时仍挂在内核中, 不需要重新挂载
+        const bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+        if (!more)
+        {
+            state.armed = false;
+        }
+        if (cqe->res > 0)
+        {
+            activate(fd, state, cqe->res);
+        }
+        else if (cqe->res < 0 && cqe->res != -ECANCELED)
+        {
+            LOG_ERROR("IoUringPoller::fillActiveChannels() fd = {} error {}", fd, strerror(-cqe->res));
+        }
+        if (!more)
+        {
+            scheduleArm(fd, state);
+        }
+    }
+
+    void IoUringPoller::handleRecvCompletion(int fd, PollState &state, const io_uring_cqe *cqe)
+    {
+        CompletionState &completion = *state.completion;
+        const int res = cqe->res;
+        const bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+        if (!more)
+        {
+            completion.recvArmed = false;
+        }
+
+        if (cqe->flags & IORING_CQE_F_BUFFER)
+        {
+            const uint16_t bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            if (res > 0)
+            {
+                completion.received.emplace_back(bid, static_cast<uint32_t>(res));
+                activate(fd, state, EPOLLIN);
+            }
+            else
+            {
+                recycleBuffer(bid);
+            }
+        }
+
+        if (res == -EINVAL && _recvMultishot)
+        {
+            // 6.0 之前的内核不支持多次触发的 recv, 改为每次完成后重新提交
+            _recvMultishot = false;
+        }
+        else if (res == -ENOBUFS)
+        {
+            // 缓冲都在等待取走, 有缓冲归还时再挂上, 不反复提交
+            completion.recvStarved = true;
+            _starvedFds.push_back(fd);
+        }
+        else if (res == 0 || (res < 0 && res != -ECANCELED))
+        {
+            // 对端关闭或出错, 排在已收到的数据之后交给 takeReceived
+            completion.recvClosed = true;
+            completion.recvResult = res;
+            activate(fd, state, EPOLLIN);
+        }
+        if (!more && !completion.recvClosed && !completion.recvStarved)
+        {
+            scheduleArm(fd, state);
+        }
+    }
+
+    void IoUringPoller::handleSendCompletion(int fd, PollState &state, const io_uring_cqe *cqe)
+    {
+        CompletionState &completion = *state.completion;
+        --completion.sendInflight;
+        if (cqe->res > 0)
+        {
+            completion.sendBytes += cqe->res;
+        }
+        else if (cqe->res < 0 && cqe->res != -ECANCELED && completion.sendError == 0)
+        {
+            completion.sendError = -cqe->res;
+        }
+        if (completion.sendInflight > 0)
+        {
+            return;
+        }
+
+        completion.sending.retrieve(completion.sendBytes);
+        if (completion.sendError == 0 && completion.sending.readableBytes() > 0)
+        {
+            // 分段多于一次提交的上限, 或链接中途被打断
+            submitSend(fd, completion);
+            return;
+        }
+        completion.sending.retrieveAll();
+        completion.sendDone = true;
+        activate(fd, state, EPOLLOUT);
+    }
+
+    void IoUringPoller::activate(int fd, PollState &state, int events)
+    {
+        if (state.revents == 0)
+        {
+            _activeFds.push_back(fd);
+        }
+        state.revents |= events;
+    }
+
+    void IoUringPoller::updateChannel(Channel *channel)
+    {
+        const int fd = channel->fd();
+        ChannelSlot &entry = slot(fd);
+        if (entry.state != kAdded)
+        {
+            entry.channel = channel;
+            entry.state = kAdded;
+        }
+        // 关注事件的变化在下一次 poll 前统一提交
+        scheduleArm(fd, state(fd));
+    }
+
+    void IoUringPoller::removeChannel(Channel *channel)
+    {
+        const int fd = channel->fd();
+        PollState &removed = state(fd);
+        if (removed.armed)
+        {
+            cancelPoll(removed);
+        }
+        if (CompletionState *completion = removed.completion.get())
+        {
+            if (completion->recvArmed)
+            {
+                cancelRequest(completion->recvTag, false);
+            }
+            for (const auto &received : completion->received)
+            {
+                recycleBuffer(received.first);
+            }
+            publishBuffers();
+            if (completion->sendInflight > 0)
+            {
+                // 内核还在读取这些内存, 持有到请求全部结束; 脱离内存池, 之后在哪里释放都可以
+                cancelRequest(completion->sendTag, true);
+                completion->sending.detachPool();
+                _orphanSends[completion->sendTag] = std::move(removed.completion);
+            }
+        }
+        removed = PollState();
+        slot(fd) = ChannelSlot();
+    }
+
+    void IoUringPoller::enableCompletionIo(Channel *channel)
+    {
+        const int fd = channel->fd();
+        PollState &enabled = state(fd);
+        if (!enabled.completion)
+        {
+            enabled.completion.reset(new CompletionState);
+        }
+        scheduleArm(fd, enabled);
+    }
+
+    ssize_t IoUringPoller::takeReceived(Channel *channel, Buffer *buf, int *savedErrno, size_t maxBytes)
+    {
+        CompletionState &completion = *state(channel->fd()).completion;
+        if (completion.received.empty())
+        {
+            if (completion.recvResult == 0)
+            {
+                return 0;
+            }
+            *savedErrno = completion.recvResult < 0 ? -completion.recvResult : EAGAIN;
+            return -1;
+        }
+
+        // 以整个接收缓冲为单位, 至少取一个
+        size_t total = 0;
+        size_t count = 0;
+        while (count < completion.received.size() && (count == 0 || total < maxBytes))
+        {
+            total += completion.received[count++].second;
+        }
+        char *dest = buf->reserve(total);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto &received = completion.received[i];
+            ::memcpy(dest, recvBuffer(received.first), received.second);
+            dest += received.second;
+            recycleBuffer(received.first);
+        }
+        buf->commit(total);
+        completion.received.erase(completion.received.begin(), completion.received.begin() + count);
+        publishBuffers();
+        return static_cast<ssize_t>(total);
+    }
+
+    void IoUringPoller::send(Channel *channel, Buffer &&data)
+    {
+        const int fd = channel->fd();
+        PollState &sending = state(fd);
+        CompletionState &completion = *sending.completion;
+        completion.sending = std::move(data);
+        completion.sendActive = true;
+        completion.sendDone = false;
+        completion.sendError = 0;
+        submitSend(fd, completion);
+        // 发送期间不再以 POLL_ADD 等待可写
+        scheduleArm(fd, sending);
+    }
+
+    bool IoUringPoller::takeSent(Channel *channel, int *savedErrno)
+    {
+        const int fd = channel->fd();
+        PollState &sent = state(fd);
+        CompletionState &completion = *sent.completion;
+        if (!completion.sendDone)
+        {
+            return false;
+        }
+        *savedErrno = completion.sendError;
+        completion.sendActive = false;
+        completion.sendDone = false;
+        completion.sendError = 0;
+        // 之后的写关注(如发送文件时)重新以 POLL_ADD 等待
+        scheduleArm(fd, sent);
+        return true;
+    }
+
+    void IoUringPoller::makeRoom(unsigned count)
+    {
+        if (_sqLocalTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) + count > _sqEntries)
+        {
+            // SQ放不下, 先把积攒的请求提交给内核
+            unsigned toSubmit = _sqLocalTail - *_sqHead;
+            __atomic_store_n(_sqTail, _sqLocalTail, __ATOMIC_RELEASE);
+            if (ioUringEnter(_ringfd, toSubmit, 0, 0, nullptr, 0) < 0)
+            {
+                LOG_FATAL("IoUringPoller::makeRoom() io_uring_enter error {}", strerror(errno));
+            }
+        }
+    }
+
+    struct io_uring_sqe *IoUringPoller::getSqe()
+    {
+        makeRoom(1);
+        unsigned index = _sqLocalTail & *_sqMask;
+        struct io_uring_sqe *sqe = &_sqes[index];
+        ::memset(sqe, 0, sizeof(*sqe));
+        _sqArray[index] = index;
+        ++_sqLocalTail;
+        return sqe;
+    }
+
+    IoUringPoller::PollState &IoUringPoller::state(int fd)
+    {
+        if (static_cast<size_t>(fd) >= _states.size())
+        {
+            _states.resize(std::max(static_cast<size_t>(fd) + 1, _states.size() * 2));
+        }
+        return _states[fd];
+    }
+
+    uint64_t IoUringPoller::nextTag(int fd, Op op)
+    {
+        // 高32位为fd, 低2位区分请求种类, 中间为递增的代数, 用于识别fd复用后过期的完成事件
+        const uint64_t generation = _nextGeneration++ & 0x3fffffff;
+        return (static_cast<uint64_t>(fd) << 32) | (generation << 2) | op;
+    }
+
+    /**
+     * @brief 需要以 POLL_ADD 等待的事件: 基于完成收发的Channel由 recv 读, 发送请求未结束时也不等待可写
+     */
+    int IoUringPoller::polledEvents(const PollState &state, const Channel *channel) const
+    {
+        int events = channel->events();
+        if (state.completion)
+        {
+            events &= ~(EPOLLIN | EPOLLPRI);
+            if (state.completion->sendActive)
+            {
+                events &= ~EPOLLOUT;
+            }
+        }
+        return events;
+    }
+
+    void IoUringPoller::applyInterest(int fd, PollState &state)
+    {
+        Channel *channel = slot(fd).channel;
+        if (channel == nullptr)
+        {
+            return;
+        }
+
+        const int events = polledEvents(state, channel);
+        const bool multishot = useMultishot(channel);
+        if (state.armed && (state.armedEvents != events || state.multishot != multishot))
+        {
+            cancelPoll(state);
+        }
+        if (!state.armed && events != 0)
+        {
+            armPoll(fd, state, events, multishot);
+        }
+
+        CompletionState *completion = state.completion.get();
+        if (completion != nullptr)
+        {
+            if (channel->isReading() && (!completion->received.empty() || completion->recvClosed))
+            {
+                // 暂停读之前收到的数据和对端关闭留在这里, 恢复后重新交给Channel
+                activate(fd, state, EPOLLIN);
+            }
+            if (channel->isReading() && !completion->recvArmed && !completion->recvClosed && !completion->recvStarved)
+            {
+                armRecv(fd, *completion);
+            }
+            else if (!channel->isReading() && completion->recvArmed && !completion->recvCancelling)
+            {
+                // 取消生效前已收到的数据仍以原来的 tag 交给Channel
+                completion->recvCancelling = true;
+                cancelRequest(completion->recvTag, false);
+            }
+        }
+    }
+
+    void IoUringPoller::armPoll(int fd, PollState &state, int events, bool multishot)
+    {
+        state.tag = nextTag(fd, kPollOp);
+        state.armed = true;
+        state.armedEvents = events;
+        state.multishot = multishot;
+        ++_armedPolls;
+
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = static_cast<uint32_t>(events);
+        // 多次触发的 poll 是边沿触发的, 只能用于回调会读写到EAGAIN的Channel
+        sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+        sqe->user_data = state.tag;
+    }
+
+    void IoUringPoller::cancelPoll(PollState &state)
+    {
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = state.tag;
+        sqe->user_data = kCancelTag;
+
+        state.tag = kCancelTag;
+        state.armed = false;
+    }
+
+    void IoUringPoller::cancelRequest(uint64_t tag, bool all)
+    {
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = tag;
+        sqe->cancel_flags = all ? IORING_ASYNC_CANCEL_ALL : 0;
+        sqe->user_data = kCancelTag;
+    }
+
+    void IoUringPoller::armRecv(int fd, CompletionState &completion)
+    {
+        completion.recvTag = nextTag(fd, kRecvOp);
+        completion.recvArmed = true;
+        completion.recvCancelling = false;
+        ++_submittedRecvs;
+
+        struct io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kBufferGroup;
+        // 多次触发的 recv 每收到一次数据完成一次, 直到缓冲环用完或出错; 否则先等可读再收, 不白做一次尝试
+        sqe->ioprio = _recvMultishot ? IORING_RECV_MULTISHOT : IORING_RECVSEND_POLL_FIRST;
+        sqe->user_data = completion.recvTag;
+    }
+
+    void IoUringPoller::submitSend(int fd, CompletionState &completion)
+    {
+        struct iovec iov[kMaxSendSegments];
+        const size_t count = completion.sending.peekSegments(iov, kMaxSendSegments);
+        completion.sendTag = nextTag(fd, kSendOp);
+        completion.sendInflight = static_cast<unsigned>(count);
+        completion.sendBytes = 0;
+        _submittedSends += count;
+
+        // 链接的请求必须在同一次提交中
+        makeRoom(static_cast<unsigned>(count));
+        for (size_t i = 0; i < count; ++i)
+        {
+            struct io_uring_sqe *sqe = getSqe();
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(iov[i].iov_base);
+            sqe->len = static_cast<uint32_t>(iov[i].iov_len);
+            // MSG_WAITALL 让内核补完短写; 出错时链接中其后的请求以 ECANCELED 结束, 数据不会乱序
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            sqe->flags = i + 1 < count ? IOSQE_IO_LINK : 0;
+            sqe->user_data = completion.sendTag;
+        }
+    }
+
+    void IoUringPoller::scheduleArm(int fd, PollState &state)
+    {
+        if (!state.pendingArm)
+        {
+            state.pendingArm = true;
+            _pendingArms.push_back(fd);
+        }
+    }
+
+    void IoUringPoller::recycleBuffer(uint16_t bid)
+    {
+        if (_bufferRing == nullptr)
+        {
+            _returnedBuffers.push_back(bid);
+            return;
+        }
+        struct io_uring_buf *buf = &_bufferRing->bufs[_bufferTail & (kRecvBuffers - 1)];
+        buf->addr = reinterpret_cast<uint64_t>(recvBuffer(bid));
+        buf->len = static_cast<uint32_t>(kRecvBufferSize);
+        buf->bid = bid;
+        ++_bufferTail;
+    }
+
+    void IoUringPoller::publishBuffers()
+    {
+        if (_bufferRing != nullptr)
+        {
+            if (_bufferRing->tail == _bufferTail)
+            {
+                return;
+            }
+            __atomic_store_n(&_bufferRing->tail, _bufferTail, __ATOMIC_RELEASE);
+        }
+        else if (_provideBuffers && !_returnedBuffers.empty())
+        {
+            // 编号连续的缓冲地址也连续, 合并成一个 PROVIDE_BUFFERS 请求
+            std::sort(_returnedBuffers.begin(), _returnedBuffers.end());
+            size_t first = 0;
+            for (size_t i = 1; i <= _returnedBuffers.size(); ++i)
+            {
+                if (i < _returnedBuffers.size() && _returnedBuffers[i] == _returnedBuffers[i - 1] + 1)
+                {
+                    continue;
+                }
+                struct io_uring_sqe *sqe = getSqe();
+                sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+                sqe->fd = static_cast<int>(i - first); // 缓冲个数
+                sqe->addr = reinterpret_cast<uint64_t>(recvBuffer(_returnedBuffers[first]));
+                sqe->len = static_cast<uint32_t>(kRecvBufferSize);
+                sqe->off = _returnedBuffers[first]; // 起始编号
+                sqe->buf_group = kBufferGroup;
+                sqe->user_data = kCancelTag;
+                first = i;
+            }
+            _returnedBuffers.clear();
+        }
+        else
+        {
+            return;
+        }
+
+        for (int fd : _starvedFds)
+        {
+            CompletionState *completion = _states[fd].completion.get();
+            if (completion != nullptr && completion->recvStarved)
+            {
+                completion->recvStarved = false;
+                scheduleArm(fd, _states[fd]);
+            }
+        }
+        _starvedFds.clear();
+    }
+} // namespace schwi
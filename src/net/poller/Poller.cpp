@@ -7,7 +7,9 @@ namespace schwi
 
     bool Poller::hasChannel(Channel *channel) const
     {
-        auto it = _channels.find(channel->fd());
-        return it != _channels.end() && it->second == channel;
+        const int fd = channel->fd();
+        return fd >= 0 &&
+               static_cast<size_t>(fd) < _channels.size() &&
+               _channels[fd].channel == channel;
     }
 } // namespace schwi
\ No newline at end of file
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+#include <algorithm>
 
 #include "base/noncopyable.hpp"
 #include "net/Channel.hpp"
@@ -9,6 +9,8 @@
 
 namespace schwi
 {
+    enum class PollerBackend;
+
     class Poller : noncopyable
     {
     public:
@@ -23,12 +25,32 @@ namespace schwi
 
         bool hasChannel(Channel *channel) const;
 
-        static Poller *newDefaultPoller(EventLoop *loop);
+        static Poller *newDefaultPoller(EventLoop *loop, PollerBackend backend);
 
     protected:
-        using ChannelMap = std::unordered_map<int, Channel *>;
-
-        ChannelMap _channels;
+        /**
+         * @brief 以fd为下标的注册表项
+         */
+        struct ChannelSlot
+        {
+            Channel *channel = nullptr; // 注册在该fd上的Channel
+            int state = -1;             // 注册状态, 由具体Poller定义
+        };
+        using ChannelTable = std::vector<ChannelSlot>;
+
+        /**
+         * @brief 获取fd对应的表项, 表按需扩容
+         */
+        ChannelSlot &slot(int fd)
+        {
+            if (static_cast<size_t>(fd) >= _channels.size())
+            {
+                _channels.resize(std::max(static_cast<size_t>(fd) + 1, _channels.size() * 2));
+            }
+            return _channels[fd];
+        }
+
+        ChannelTable _channels;
 
     private:
         EventLoop *_ownerLoop;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <functional>
+
+#include "base/noncopyable.hpp"
+#include "base/MonoTime.hpp"
+#include "timer/TimerId.hpp"
+
+namespace schwi
+{
+    /**
+     * @brief 定时器队列接口
+     */
+    class ITimerQueue : noncopyable
+    {
+    public:
+        using TimerCallback = std::function<void()>;
+
+        ITimerQueue() = default;
+        virtual ~ITimerQueue() = default;
+
+        /**
+         * @brief 添加定时器, 线程安全
+         * @param cb 回调
+         * @param when 首次超时时刻
+         * @param interval 重复间隔(秒), 0 表示一次性定时器
+         */
+        virtual TimerId addTimer(TimerCallback cb, MonoTime when, double interval) = 0;
+
+        /**
+         * @brief 取消定时器, 线程安全, 对已经执行完毕的一次性定时器无效果
+         */
+        virtual void cancel(TimerId timerId) = 0;
+
+        /**
+         * @brief 最近一个定时器的超时时刻, 没有定时器时返回 MonoTime::invalid(), 只能在loop线程调用
+         */
+        virtual MonoTime nextExpiration() const = 0;
+
+        /**
+         * @brief 执行 now 之前到期的定时器, 只能在loop线程调用
+         *
+         * 不使用timerfd时由EventLoop在每次poll返回后调用
+         */
+        virtual void processExpired(MonoTime now) = 0;
+    }; // class ITimerQueue
+} // namespace schwi
\ No newline at end of file
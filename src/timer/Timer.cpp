@@ -2,7 +2,9 @@
 
 namespace schwi
 {
-    void Timer::restart(Timestamp now)
+    std::atomic_int64_t Timer::_numCreated(0);
+
+    void Timer::restart(MonoTime now)
     {
         if (_repeat)
         {
@@ -11,7 +13,16 @@ namespace schwi
         }
         else
         {
-            _expiration = Timestamp::invalid();
+            _expiration = MonoTime::invalid();
         }
     }
+
+    void Timer::reset(TimerCallback cb, MonoTime when, double interval)
+    {
+        _callback = std::move(cb);
+        _expiration = when;
+        _interval = interval;
+        _repeat = interval > 0.0;
+        _sequence = ++_numCreated;
+    }
 } // namespace schwi
\ No newline at end of file
@@ -31,50 +31,96 @@ namespace schwi
         }
     }
 
-    TimerQueue::TimerQueue(EventLoop *loop)
+    TimerQueue::TimerQueue(EventLoop *loop, bool useTimerfd)
         : _loop(loop),
-          _timerfd(createTimerfd()),
+          _timerfd(useTimerfd ? createTimerfd() : -1),
           _timerfdChannel(loop, _timerfd),
-          _timers()
+          _timers(),
+          _callingExpiredTimers(false)
     {
-        _timerfdChannel.setReadCallback(std::bind(&TimerQueue::handleRead, this));
-        _timerfdChannel.enableReading();
+        if (_timerfd >= 0)
+        {
+            _timerfdChannel.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+            _timerfdChannel.enableReading();
+        }
     }
 
     TimerQueue::~TimerQueue()
     {
-        _timerfdChannel.disableAll();
-        _timerfdChannel.remove();
-        ::close(_timerfd);
+        if (_timerfd >= 0)
+        {
+            _timerfdChannel.disableAll();
+            _timerfdChannel.remove();
+            ::close(_timerfd);
+        }
         for (auto &timer : _timers)
         {
             delete timer.second;
         }
     }
 
-    void TimerQueue::addTimer(const Timer::TimerCallback &cb, Timestamp when, double interval)
+    TimerId TimerQueue::addTimer(TimerCallback cb, MonoTime when, double interval)
     {
-        Timer *timer = new Timer(cb, when, interval);
+        Timer *timer = new Timer(std::move(cb), when, interval);
         _loop->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+        return TimerId(timer, timer->sequence());
+    }
+
+    void TimerQueue::cancel(TimerId timerId)
+    {
+        _loop->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
     }
 
     void TimerQueue::addTimerInLoop(Timer *timer)
     {
         bool earliestChanged = insert(timer);
-        if (earliestChanged)
+        if (earliestChanged && _timerfd >= 0)
         {
             resetTimerfd(_timerfd, timer->expiration());
         }
     }
 
+    void TimerQueue::cancelInLoop(TimerId timerId)
+    {
+        ActiveTimer timer(timerId.timer(), timerId.sequence());
+        auto it = _activeTimers.find(timer);
+        if (it != _activeTimers.end())
+        {
+            _timers.erase(Entry(it->first->expiration(), it->first));
+            delete it->first;
+            _activeTimers.erase(it);
+        }
+        else if (_callingExpiredTimers)
+        {
+            // 正在执行的定时器在回调中取消自身, 在reset中不再重启
+            _cancelingTimers.insert(timer);
+        }
+    }
+
+    MonoTime TimerQueue::nextExpiration() const
+    {
+        return _timers.empty() ? MonoTime::invalid() : _timers.begin()->first;
+    }
+
     void TimerQueue::handleRead()
     {
-        Timestamp now(Timestamp::now());
+        MonoTime now(_loop->now());
         ReadTimerfd(_timerfd);
+        processExpired(now);
+    }
+
+    void TimerQueue::processExpired(MonoTime now)
+    {
+        // poll超时驱动时每轮都会调用, 没有到期定时器直接返回; timerfd模式仍需走到reset重设timerfd
+        if (_timerfd < 0 && (_timers.empty() || now < _timers.begin()->first))
+        {
+            return;
+        }
 
         std::vector<Entry> expired = getExpired(now);
 
         _callingExpiredTimers = true;
+        _cancelingTimers.clear();
         for (auto &entry : expired)
         {
             entry.second->run();
@@ -83,7 +129,7 @@ namespace schwi
         reset(expired, now);
     }
 
-    void TimerQueue::resetTimerfd(int timerfd, Timestamp expiration)
+    void TimerQueue::resetTimerfd(int timerfd, MonoTime expiration)
     {
         struct itimerspec new_value;
         struct itimerspec old_value;
@@ -91,7 +137,7 @@ namespace schwi
         bzero(&new_value, sizeof(new_value));
         bzero(&old_value, sizeof(old_value));
 
-        int64_t micro_seconds = expiration.microseconds() - Timestamp::now().microseconds();
+        int64_t micro_seconds = expiration.microseconds() - MonoTime::now().microseconds();
         if (micro_seconds < 100)
         {
             micro_seconds = 100;
@@ -108,21 +154,26 @@ namespace schwi
         }
     }
 
-    std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+    std::vector<TimerQueue::Entry> TimerQueue::getExpired(MonoTime now)
     {
         Entry sentry = std::make_pair(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
         auto end = _timers.lower_bound(sentry);
         std::vector<Entry> expired(_timers.begin(), end);
         _timers.erase(_timers.begin(), end);
+        for (const Entry &entry : expired)
+        {
+            _activeTimers.erase(ActiveTimer(entry.second, entry.second->sequence()));
+        }
 
         return expired;
     }
 
-    void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now)
+    void TimerQueue::reset(const std::vector<Entry> &expired, MonoTime now)
     {
         for (auto &entry : expired)
         {
-            if (entry.second->repeat())
+            ActiveTimer timer(entry.second, entry.second->sequence());
+            if (entry.second->repeat() && _cancelingTimers.find(timer) == _cancelingTimers.end())
             {
                 entry.second->restart(now);
                 insert(entry.second);
@@ -131,24 +182,26 @@ namespace schwi
             {
                 delete entry.second;
             }
+        }
 
-            if (!_timers.empty())
-            {
-                resetTimerfd(_timerfd, _timers.begin()->second->expiration());
-            }
+        // 所有到期定时器处理完后只重设一次timerfd
+        if (!_timers.empty() && _timerfd >= 0)
+        {
+            resetTimerfd(_timerfd, _timers.begin()->second->expiration());
         }
     }
 
     bool TimerQueue::insert(Timer *timer)
     {
         bool earliestChanged = false;
-        Timestamp when = timer->expiration();
+        MonoTime when = timer->expiration();
         auto iter = _timers.begin();
         if (iter == _timers.end() || when < iter->first)
         {
             earliestChanged = true;
         }
         _timers.insert(std::make_pair(when, timer));
+        _activeTimers.insert(ActiveTimer(timer, timer->sequence()));
         return earliestChanged;
     }
 } // namespace schwi
\ No newline at end of file
@@ -0,0 +1,340 @@
+#include "timer/TimerWheel.hpp"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+
+#include "base/base.hpp"
+#include "net/EventLoop.hpp"
+
+namespace schwi
+{
+    // 定义在 TimerQueue.cpp
+    int createTimerfd();
+    void ReadTimerfd(int timerfd);
+
+    TimerWheel::TimerWheel(EventLoop *loop, double tick, bool useTimerfd)
+        : _loop(loop),
+          _tickMicros(std::max<int64_t>(1, static_cast<int64_t>(tick * Timestamp::kMicroSecondsPerSecond))),
+          _base(MonoTime::now()),
+          _timerfd(useTimerfd ? createTimerfd() : -1),
+          _timerfdChannel(loop, _timerfd),
+          _armedAt(MonoTime::invalid()),
+          _currentTick(0),
+          _size(0),
+          _slots(kNumSlots + 1, nullptr)
+    {
+        if (_timerfd >= 0)
+        {
+            _timerfdChannel.setReadCallback(std::bind(&TimerWheel::handleRead, this));
+            _timerfdChannel.enableReading();
+        }
+    }
+
+    TimerWheel::~TimerWheel()
+    {
+        if (_timerfd >= 0)
+        {
+            _timerfdChannel.disableAll();
+            _timerfdChannel.remove();
+            ::close(_timerfd);
+        }
+    }
+
+    TimerId TimerWheel::addTimer(TimerCallback cb, MonoTime when, double interval)
+    {
+        if (_loop->isInLoopThread())
+        {
+            Node *node = allocNode(std::move(cb), when, interval);
+            addTimerInLoop(node);
+            return TimerId(node, node->sequence());
+        }
+
+        // 空闲节点只能在loop线程中访问, 其他线程新建节点后交给loop线程接管
+        Node *node = new Node(std::move(cb), when, interval);
+        TimerId timerId(node, node->sequence());
+        _loop->queueInLoop([this, node]
+                           {
+            _nodes.emplace_back(node);
+            addTimerInLoop(node); });
+        return timerId;
+    }
+
+    void TimerWheel::cancel(TimerId timerId)
+    {
+        _loop->runInLoop(std::bind(&TimerWheel::cancelInLoop, this, timerId));
+    }
+
+    TimerWheel::Node *TimerWheel::allocNode(TimerCallback &&cb, MonoTime when, double interval)
+    {
+        if (!_freeNodes.empty())
+        {
+            Node *node = _freeNodes.back();
+            _freeNodes.pop_back();
+            node->reset(std::move(cb), when, interval);
+            return node;
+        }
+        _nodes.emplace_back(new Node(std::move(cb), when, interval));
+        return _nodes.back().get();
+    }
+
+    void TimerWheel::freeNode(Node *node)
+    {
+        // 重置会更换序号, 使指向该节点的TimerId全部失效
+        node->reset(TimerCallback(), MonoTime::invalid(), 0.0);
+        node->slot = kNoSlot;
+        _freeNodes.push_back(node);
+        --_size;
+    }
+
+    void TimerWheel::addTimerInLoop(Node *node)
+    {
+        int64_t expireTick = (node->expiration().microseconds() - _base.microseconds() + _tickMicros - 1) / _tickMicros;
+        node->expireTick = std::max(expireTick, _currentTick);
+        node->intervalTicks = node->repeat() ? ticksOf(node->interval()) : 0;
+        place(node);
+        ++_size;
+
+        if (_timerfd >= 0)
+        {
+            // 已设置时, 到期时刻不晚于下一次第一层转完一圈, 只有第一层中更早的节点需要提前
+            MonoTime wake(_base.microseconds() + node->expireTick * _tickMicros);
+            if (!_armedAt.valid() || (node->slot < kRootSize && wake < _armedAt))
+            {
+                resetTimerfd();
+            }
+        }
+    }
+
+    void TimerWheel::cancelInLoop(TimerId timerId)
+    {
+        Node *node = static_cast<Node *>(timerId.timer());
+        if (node == nullptr || node->sequence() != timerId.sequence())
+        {
+            return;
+        }
+
+        if (node->slot == kRunningSlot)
+        {
+            // 回调中取消自身, 执行完后不再重启
+            node->intervalTicks = 0;
+        }
+        else if (node->slot != kNoSlot)
+        {
+            unlink(node);
+            freeNode(node);
+        }
+    }
+
+    MonoTime TimerWheel::nextExpiration() const
+    {
+        if (_size == 0)
+        {
+            return MonoTime::invalid();
+        }
+
+        // 第一层内找下一个非空槽; 都为空时在第一层转完一圈、需要逐层下放时醒来
+        int64_t tick = _currentTick;
+        if ((tick & kRootMask) != 0)
+        {
+            while (_slots[tick & kRootMask] == nullptr && ((tick + 1) & kRootMask) != 0)
+            {
+                ++tick;
+            }
+            if (_slots[tick & kRootMask] == nullptr)
+            {
+                ++tick;
+            }
+        }
+        return MonoTime(_base.microseconds() + tick * _tickMicros);
+    }
+
+    void TimerWheel::processExpired(MonoTime now)
+    {
+        if (tickOf(now) >= _currentTick)
+        {
+            advance(now);
+        }
+    }
+
+    void TimerWheel::handleRead()
+    {
+        ReadTimerfd(_timerfd);
+        _armedAt = MonoTime::invalid(); // 单次触发后timerfd已失效
+        advance(_loop->now());
+        resetTimerfd();
+    }
+
+    void TimerWheel::advance(MonoTime now)
+    {
+        const int64_t target = tickOf(now);
+        while (_currentTick <= target)
+        {
+            if (_size == 0)
+            {
+                // 时间轮为空时直接跳过, 不影响之后的相对插入
+                _currentTick = target + 1;
+                break;
+            }
+
+            int index = static_cast<int>(_currentTick & kRootMask);
+            if (index == 0)
+            {
+                // 第一层转完一圈, 逐层把上层对应槽里的定时器下放
+                for (int level = 0; level < kLevels; ++level)
+                {
+                    int levelIndex = static_cast<int>((_currentTick >> (kRootBits + level * kLevelBits)) & kLevelMask);
+                    cascade(level, levelIndex);
+                    if (levelIndex != 0)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            Node *head = _slots[index];
+            _slots[index] = nullptr;
+            for (Node *node = head; node != nullptr; node = node->next)
+            {
+                node->slot = kExpiredSlot;
+            }
+            _slots[kExpiredSlot] = head;
+
+            ++_currentTick;
+            runExpired();
+        }
+    }
+
+    void TimerWheel::cascade(int level, int index)
+    {
+        int slot = kRootSize + level * kLevelSize + index;
+        Node *node = _slots[slot];
+        _slots[slot] = nullptr;
+        while (node != nullptr)
+        {
+            Node *next = node->next;
+            place(node);
+            node = next;
+        }
+    }
+
+    void TimerWheel::runExpired()
+    {
+        while (Node *node = _slots[kExpiredSlot])
+        {
+            unlink(node);
+            node->slot = kRunningSlot;
+            node->run();
+
+            if (node->intervalTicks > 0)
+            {
+                node->expireTick = std::max(node->expireTick + node->intervalTicks, _currentTick);
+                place(node);
+            }
+            else
+            {
+                freeNode(node);
+            }
+        }
+    }
+
+    void TimerWheel::place(Node *node)
+    {
+        int64_t expire = node->expireTick;
+        int64_t delta = expire - _currentTick;
+        int slot = 0;
+        if (delta < 0)
+        {
+            slot = static_cast<int>(_currentTick & kRootMask);
+        }
+        else if (delta < kRootSize)
+        {
+            slot = static_cast<int>(expire & kRootMask);
+        }
+        else
+        {
+            int level = 0;
+            while (level < kLevels - 1 && delta >= (int64_t(1) << (kRootBits + (level + 1) * kLevelBits)))
+            {
+                ++level;
+            }
+            if (delta >= (int64_t(1) << (kRootBits + kLevels * kLevelBits)))
+            {
+                // 超出时间轮范围, 放在最远处, 下放时会重新计算
+                expire = _currentTick + (int64_t(1) << (kRootBits + kLevels * kLevelBits)) - 1;
+            }
+            slot = kRootSize + level * kLevelSize +
+                   static_cast<int>((expire >> (kRootBits + level * kLevelBits)) & kLevelMask);
+        }
+        link(node, slot);
+    }
+
+    void TimerWheel::link(Node *node, int slot)
+    {
+        node->slot = slot;
+        node->prev = nullptr;
+        node->next = _slots[slot];
+        if (node->next != nullptr)
+        {
+            node->next->prev = node;
+        }
+        _slots[slot] = node;
+    }
+
+    void TimerWheel::unlink(Node *node)
+    {
+        if (node->prev != nullptr)
+        {
+            node->prev->next = node->next;
+        }
+        else
+        {
+            _slots[node->slot] = node->next;
+        }
+        if (node->next != nullptr)
+        {
+            node->next->prev = node->prev;
+        }
+        node->prev = nullptr;
+        node->next = nullptr;
+        node->slot = kNoSlot;
+    }
+
+    int64_t TimerWheel::ticksOf(double seconds) const
+    {
+        int64_t micros = static_cast<int64_t>(std::llround(seconds * Timestamp::kMicroSecondsPerSecond));
+        return std::max<int64_t>(1, (micros + _tickMicros / 2) / _tickMicros);
+    }
+
+    int64_t TimerWheel::tickOf(MonoTime time) const
+    {
+        return (time.microseconds() - _base.microseconds()) / _tickMicros;
+    }
+
+    void TimerWheel::resetTimerfd()
+    {
+        MonoTime next = nextExpiration();
+        if (next == _armedAt)
+        {
+            return;
+        }
+
+        struct itimerspec value;
+        bzero(&value, sizeof(value));
+        if (next.valid())
+        {
+            // 单次触发, 到期处理后按新的最近到期时刻重新设置; 设置为0会停止timerfd
+            int64_t micros = std::max<int64_t>(100, next.microseconds() - MonoTime::now().microseconds());
+            value.it_value.tv_sec = static_cast<time_t>(micros / Timestamp::kMicroSecondsPerSecond);
+            value.it_value.tv_nsec = static_cast<long>((micros % Timestamp::kMicroSecondsPerSecond) * 1000);
+        }
+
+        if (::timerfd_settime(_timerfd, 0, &value, nullptr) < 0)
+        {
+            LOG_ERROR("TimerWheel::resetTimerfd() timerfd_settime error {}", strerror(errno));
+        }
+        _armedAt = next;
+    }
+} // namespace schwi
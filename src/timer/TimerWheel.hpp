@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "base/MonoTime.hpp"
+#include "net/Channel.hpp"
+#include "timer/ITimerQueue.hpp"
+#include "timer/Timer.hpp"
+
+namespace schwi
+{
+    class EventLoop;
+
+    /**
+     * @brief 分层时间轮定时器队列
+     *
+     * 精度为一个tick, 插入与取消均为O(1), 适合大量连接的空闲/请求超时。
+     * 一层256个槽, 之上四层各64个槽, 共可覆盖2^32个tick。
+     * 定时器节点由时间轮持有并复用, 过期的TimerId通过序号识别。
+     * useTimerfd 为false时不创建timerfd, 由EventLoop按 nextExpiration() 计算poll超时。
+     */
+    class TimerWheel : public ITimerQueue
+    {
+    public:
+        static constexpr double kDefaultTick = 0.01; // 默认tick为10ms
+
+        TimerWheel(EventLoop *loop, double tick = kDefaultTick, bool useTimerfd = true);
+        ~TimerWheel() override;
+
+        TimerId addTimer(TimerCallback cb, MonoTime when, double interval) override;
+        void cancel(TimerId timerId) override;
+        MonoTime nextExpiration() const override;
+        void processExpired(MonoTime now) override;
+
+        size_t size() const { return _size; } // 时间轮中的定时器数量
+
+    private:
+        static const int kRootBits = 8;
+        static const int kLevelBits = 6;
+        static const int kLevels = 4; // 除第一层外的层数
+        static const int kRootSize = 1 << kRootBits;
+        static const int kLevelSize = 1 << kLevelBits;
+        static const int kRootMask = kRootSize - 1;
+        static const int kLevelMask = kLevelSize - 1;
+        static const int kNumSlots = kRootSize + kLevels * kLevelSize;
+        static const int kExpiredSlot = kNumSlots; // 正在处理的到期链表
+        static const int kNoSlot = -1;             // 不在时间轮中
+        static const int kRunningSlot = -2;        // 回调正在执行
+
+        /**
+         * @brief 时间轮节点, 以侵入式双向链表挂在槽上
+         */
+        struct Node : public Timer
+        {
+            Node(TimerCallback cb, MonoTime when, double interval)
+                : Timer(std::move(cb), when, interval)
+            {
+            }
+
+            Node *prev = nullptr;
+            Node *next = nullptr;
+            int slot = kNoSlot;
+            int64_t expireTick = 0;
+            int64_t intervalTicks = 0;
+        };
+
+        Node *allocNode(TimerCallback &&cb, MonoTime when, double interval);
+        void freeNode(Node *node);
+
+        void addTimerInLoop(Node *node);
+        void cancelInLoop(TimerId timerId);
+
+        void handleRead();
+        void advance(MonoTime now);
+        void cascade(int level, int index);
+        void runExpired();
+
+        void place(Node *node);
+        void link(Node *node, int slot);
+        void unlink(Node *node);
+
+        int64_t ticksOf(double seconds) const;
+        int64_t tickOf(MonoTime time) const;
+        void resetTimerfd(); // 按最近的到期时刻设置单次timerfd
+
+        EventLoop *_loop;
+        const int64_t _tickMicros;
+        const MonoTime _base; // tick 0 对应的时刻
+        const int _timerfd;
+        Channel _timerfdChannel;
+        MonoTime _armedAt; // timerfd当前的到期时刻, 未设置时无效
+
+        int64_t _currentTick; // 下一个待处理的tick
+        size_t _size;
+        std::vector<Node *> _slots;                // 各槽链表头, 最后一个为到期链表
+        std::vector<std::unique_ptr<Node>> _nodes; // 持有所有节点, 保证过期的TimerId仍指向有效对象
+        std::vector<Node *> _freeNodes;            // 可复用的空闲节点
+    };
+} // namespace schwi
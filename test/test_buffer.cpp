@@ -0,0 +1,265 @@
+#include "net/Buffer.hpp"
+#include "net/BufferPool.hpp"
+#include "net/ReadSizePredictor.hpp"
+#include "log/LogStream.hpp"
+#include "base/base.hpp"
+
+#include <string>
+#include <iterator>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <gtest/gtest.h>
+
+using namespace schwi;
+using namespace std;
+
+class BufferTest : public testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        auto logger = make_shared<Logger>(Logger::ERROR, make_shared<LogConsole>());
+        GlobalLogger::Instance().setLogger(logger);
+    }
+};
+
+// 测试默认模式的追加与取出
+TEST_F(BufferTest, Contiguous)
+{
+    Buffer buf;
+    EXPECT_FALSE(buf.chained());
+    buf.append(string(2000, 'a'));
+    buf.append("\r\n", 2);
+    EXPECT_EQ(buf.readableBytes(), 2002u);
+    EXPECT_EQ(buf.findCRLF(), buf.peek() + 2000);
+    EXPECT_EQ(buf.retrieveAsString(1000), string(1000, 'a'));
+    EXPECT_EQ(buf.readableBytes(), 1002u);
+}
+
+// 测试链式模式接管外部内存而不拷贝, 取出时跨越多个分段
+TEST_F(BufferTest, ChainedOwnership)
+{
+    Buffer buf;
+    buf.setChained(true);
+    EXPECT_TRUE(buf.chained());
+
+    string big(100 * 1024, 'b');
+    buf.append("head", 4);
+    buf.append(std::move(big));
+    EXPECT_EQ(buf.segmentCount(), 2u);
+
+    shared_ptr<const char[]> shared(new char[4096]());
+    buf.append(shared, 4096);
+    EXPECT_EQ(shared.use_count(), 2);
+    EXPECT_EQ(buf.segmentCount(), 3u);
+
+    // 外部分段之后的小块数据写入新的分段
+    buf.append("tail", 4);
+    EXPECT_EQ(buf.segmentCount(), 4u);
+    EXPECT_EQ(buf.readableBytes(), 4 + 100 * 1024 + 4096 + 4u);
+
+    EXPECT_EQ(buf.retrieveAsString(6), "head" + string(2, 'b'));
+    buf.retrieve(100 * 1024 - 2);
+    EXPECT_EQ(buf.segmentCount(), 2u);
+    buf.retrieve(4096);
+    EXPECT_EQ(shared.use_count(), 1);
+    EXPECT_EQ(buf.retrieveAllAsString(), "tail");
+    EXPECT_EQ(buf.readableBytes(), 0u);
+}
+
+// 测试链式模式用一次writev写出所有分段
+TEST_F(BufferTest, ChainedWritev)
+{
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int sndbuf = 1 << 20;
+    ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    Buffer buf;
+    buf.setChained(true);
+    string expected;
+    for (int i = 0; i < 8; ++i)
+    {
+        string part(1024, static_cast<char>('0' + i));
+        expected += part;
+        buf.append(std::move(part));
+    }
+    EXPECT_EQ(buf.segmentCount(), 8u);
+
+    int savedErrno = 0;
+    ssize_t n = buf.writeFd(fds[0], &savedErrno);
+    ASSERT_EQ(n, static_cast<ssize_t>(expected.size()));
+    buf.retrieve(n);
+    EXPECT_EQ(buf.readableBytes(), 0u);
+
+    string received(expected.size(), '\0');
+    size_t got = 0;
+    while (got < received.size())
+    {
+        ssize_t r = ::read(fds[1], &received[got], received.size() - got);
+        ASSERT_GT(r, 0);
+        got += r;
+    }
+    EXPECT_EQ(received, expected);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// 测试使用内存池时按需借用, 读空后归还, 空闲内存在trim后释放
+TEST_F(BufferTest, Pool)
+{
+    BufferPool pool;
+    Buffer buf(&pool);
+    EXPECT_EQ(buf.capacity(), 0u);
+    EXPECT_EQ(buf.readableBytes(), 0u);
+    EXPECT_EQ(buf.findCRLF(), nullptr);
+
+    buf.append("hello\r\n", 7);
+    EXPECT_EQ(buf.capacity(), BufferPool::kMinClassSize);
+    EXPECT_EQ(pool.borrowedBytes(), BufferPool::kMinClassSize);
+
+    // 增长时保留未读数据
+    buf.retrieve(2);
+    buf.append(string(5000, 'x'));
+    EXPECT_EQ(buf.capacity(), 8u * 1024);
+    EXPECT_EQ(buf.retrieveAsString(5), "llo\r\n");
+
+    buf.retrieveAll();
+    EXPECT_EQ(buf.capacity(), 0u);
+    EXPECT_EQ(pool.borrowedBytes(), 0u);
+    EXPECT_EQ(pool.cachedBytes(), 9u * 1024);
+
+    // 再次借用时复用池中的内存
+    buf.append("again", 5);
+    EXPECT_EQ(pool.cachedBytes(), 8u * 1024);
+
+    // 第一次trim开始统计, 第二次释放整个周期都没有用到的块
+    pool.trim();
+    EXPECT_EQ(pool.cachedBytes(), 8u * 1024);
+    pool.trim();
+    EXPECT_EQ(pool.cachedBytes(), 0u);
+
+    // 脱离内存池时迁移未读数据
+    buf.setPool(nullptr);
+    EXPECT_EQ(pool.borrowedBytes(), 0u);
+    EXPECT_EQ(buf.retrieveAllAsString(), "again");
+
+    // detachPool 不拷贝, 借出的内存直接改为独立分配
+    Buffer moved(&pool);
+    moved.append("moved", 5);
+    const char *data = moved.peek();
+    moved.detachPool();
+    EXPECT_EQ(moved.pool(), nullptr);
+    EXPECT_EQ(moved.peek(), data);
+    EXPECT_EQ(pool.borrowedBytes(), 0u);
+    EXPECT_EQ(moved.retrieveAllAsString(), "moved");
+}
+
+// 测试读取大小预测: 读满时快速放大, 连续两次偏小才缩小
+TEST_F(BufferTest, ReadSizePredictor)
+{
+    ReadSizePredictor predictor;
+    EXPECT_EQ(predictor.nextReadSize(), 1024u);
+
+    predictor.record(1024);
+    EXPECT_EQ(predictor.nextReadSize(), 4096u);
+    predictor.record(100);
+    EXPECT_EQ(predictor.nextReadSize(), 4096u);
+    predictor.record(100);
+    EXPECT_EQ(predictor.nextReadSize(), 2048u);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        predictor.record(1 << 20);
+    }
+    EXPECT_EQ(predictor.nextReadSize(), 64u * 1024);
+    for (int i = 0; i < 40; ++i)
+    {
+        predictor.record(1);
+    }
+    EXPECT_EQ(predictor.nextReadSize(), ReadSizePredictor::kMinSize);
+}
+
+// 测试按预测大小预留空间后直接读入缓冲区, 没有读到数据时归还借用的内存
+TEST_F(BufferTest, ReadFdWithPredictor)
+{
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+
+    BufferPool pool;
+    Buffer buf(&pool);
+    ReadSizePredictor predictor;
+
+    string payload(3000, 'r');
+    ASSERT_EQ(::write(fds[1], payload.data(), payload.size()), static_cast<ssize_t>(payload.size()));
+
+    int savedErrno = 0;
+    EXPECT_EQ(buf.readFd(fds[0], &savedErrno, &predictor), 3000);
+    EXPECT_EQ(buf.retrieveAllAsString(), payload);
+    EXPECT_EQ(predictor.nextReadSize(), 4096u);
+    EXPECT_EQ(pool.borrowedBytes(), 0u);
+
+    // 再次读取时借用4KiB, 3000字节全部直接读入
+    ASSERT_EQ(::write(fds[1], payload.data(), payload.size()), static_cast<ssize_t>(payload.size()));
+    EXPECT_EQ(buf.readFd(fds[0], &savedErrno, &predictor), 3000);
+    EXPECT_EQ(buf.capacity(), 4096u);
+    buf.retrieveAll();
+
+    EXPECT_EQ(buf.readFd(fds[0], &savedErrno, &predictor), -1);
+    EXPECT_EQ(savedErrno, EAGAIN);
+    EXPECT_EQ(pool.borrowedBytes(), 0u);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// 测试 reserve/commit、appendFormat 与 prepend 在两种模式下的行为
+TEST_F(BufferTest, SerializeInPlace)
+{
+    for (bool chained : {false, true})
+    {
+        BufferPool pool;
+        Buffer buf(&pool);
+        buf.setChained(chained);
+
+        char *p = buf.reserve(5);
+        ::memcpy(p, "hello", 5);
+        buf.commit(5);
+        buf.appendFormat(" {} {}", 42, string(200, 'x'));
+        fmt::format_to(back_inserter(buf), "!");
+
+        uint32_t header = static_cast<uint32_t>(buf.readableBytes());
+        buf.prepend(&header, sizeof header);
+        EXPECT_EQ(buf.readableBytes(), 4u + 5 + 4 + 200 + 1);
+        string all = buf.retrieveAllAsString();
+        EXPECT_EQ(::memcmp(all.data(), &header, sizeof header), 0);
+        EXPECT_EQ(all.substr(4), "hello 42 " + string(200, 'x') + "!");
+    }
+
+    // 借用池内存的空缓冲区也能直接写入头部
+    BufferPool pool;
+    Buffer buf(&pool);
+    buf.prepend("ab", 2);
+    EXPECT_EQ(buf.retrieveAllAsString(), "ab");
+
+    // 头部超过预留区时后移数据或重新分配
+    for (size_t dataLen : {10, 5000})
+    {
+        Buffer small(&pool);
+        small.append(string(dataLen, 'd'));
+        string header(100, 'h');
+        small.prepend(header.data(), header.size());
+        EXPECT_EQ(small.prependableBytes(), static_cast<size_t>(Buffer::kCheapPrepend));
+        EXPECT_EQ(small.retrieveAllAsString(), header + string(dataLen, 'd'));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,105 @@
+#include "base/ByteSearch.hpp"
+#include "net/Buffer.hpp"
+#include "http/HttpContext.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace schwi;
+using namespace std;
+
+class ByteSearchTest : public testing::TestWithParam<ByteSearch::Isa>
+{
+protected:
+    void SetUp() override
+    {
+        if (!ByteSearch::setIsa(GetParam()))
+        {
+            GTEST_SKIP() << "isa not supported";
+        }
+    }
+
+    void TearDown() override
+    {
+        ByteSearch::setIsa(ByteSearch::detectIsa());
+    }
+};
+
+// 与标准库实现对比, 覆盖各种长度、起始偏移和命中位置(包括跨越向量块边界的CRLF)
+TEST_P(ByteSearchTest, MatchesReference)
+{
+    mt19937 rng(42);
+    const string alphabet = "ab\r\n:";
+    vector<char> data(200);
+    for (int round = 0; round < 2000; ++round)
+    {
+        for (char &c : data)
+        {
+            c = alphabet[rng() % (round % 2 == 0 ? 2 : alphabet.size())];
+        }
+        size_t offset = rng() % 40;
+        size_t len = rng() % (data.size() - offset);
+        const char *begin = data.data() + offset;
+        const char *end = begin + len;
+
+        const char crlf[] = "\r\n";
+        EXPECT_EQ(ByteSearch::findCRLF(begin, end), search(begin, end, crlf, crlf + 2));
+        EXPECT_EQ(ByteSearch::findEOL(begin, end), find(begin, end, '\n'));
+        EXPECT_EQ(ByteSearch::findByte(begin, end, ':'), find(begin, end, ':'));
+        EXPECT_EQ(ByteSearch::findBytes(begin, end, ':', '\r'),
+                  find_if(begin, end, [](char c)
+                          { return c == ':' || c == '\r'; }));
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Isa, ByteSearchTest, testing::Values(ByteSearch::kScalar, ByteSearch::kSse2, ByteSearch::kAvx2));
+
+// 测试Buffer从上次检查的位置继续查找
+TEST(BufferSearchTest, Resume)
+{
+    Buffer buf;
+    buf.append(string(100, 'x') + "\r");
+    EXPECT_EQ(buf.findCRLF(), nullptr);
+    const char *resume = buf.peek() + buf.readableBytes() - 1;
+
+    buf.append("\nrest\n", 6);
+    EXPECT_EQ(buf.findCRLF(resume), buf.peek() + 100);
+    EXPECT_EQ(buf.findEOL(), buf.peek() + 101);
+    EXPECT_EQ(buf.findByte('r'), buf.peek() + 102);
+    EXPECT_EQ(buf.findByte('z'), nullptr);
+}
+
+// 测试请求头分多次到达时的增量解析, 包括CR与LF被拆开的情况
+TEST(HttpContextTest, Incremental)
+{
+    const string request = "GET /index.html?a=1 HTTP/1.1\r\n"
+                           "Host: example.com\r\n"
+                           "User-Agent: test\r\n"
+                           "\r\n";
+    for (size_t step : {1, 3, 7, 64})
+    {
+        HttpContext context;
+        Buffer buf;
+        for (size_t i = 0; i < request.size(); i += step)
+        {
+            buf.append(request.substr(i, step));
+            ASSERT_TRUE(context.parseRequest(&buf, Timestamp::now()));
+        }
+        ASSERT_TRUE(context.gotAll());
+        EXPECT_EQ(context.request().path(), "/index.html");
+        EXPECT_EQ(context.request().query(), "?a=1");
+        EXPECT_EQ(context.request().getHeader("Host"), "example.com");
+        EXPECT_EQ(context.request().getHeader("User-Agent"), "test");
+        EXPECT_EQ(buf.readableBytes(), 0u);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,185 @@
+#include "net/codec/LengthFieldCodec.hpp"
+#include "net/codec/VarintCodec.hpp"
+#include "net/codec/DelimiterCodec.hpp"
+#include "net/TcpServer.hpp"
+#include "net/Buffer.hpp"
+#include "log/LogStream.hpp"
+#include "base/base.hpp"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+using namespace schwi;
+using namespace std;
+
+class CodecTest : public testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        auto logger = make_shared<Logger>(Logger::ERROR, make_shared<LogConsole>());
+        GlobalLogger::Instance().setLogger(logger);
+    }
+};
+
+// 测试各编码器写出的帧头
+TEST_F(CodecTest, Encode)
+{
+    auto ignore = [](const TcpConnectionPtr &, string_view, Timestamp) {};
+
+    Buffer buf;
+    buf.append("abc", 3);
+    EXPECT_TRUE(LengthFieldCodec(ignore, 2, LengthFieldCodec::kBigEndian).encode(&buf));
+    EXPECT_EQ(buf.retrieveAllAsString(), string("\x00\x03"
+                                                "abc",
+                                                5));
+
+    buf.append("abc", 3);
+    EXPECT_TRUE(LengthFieldCodec(ignore, 4, LengthFieldCodec::kLittleEndian).encode(&buf));
+    EXPECT_EQ(buf.retrieveAllAsString(), string("\x03\x00\x00\x00"
+                                                "abc",
+                                                7));
+
+    buf.append(string(300, 'v'));
+    EXPECT_FALSE(LengthFieldCodec(ignore, 1).encode(&buf));
+    EXPECT_EQ(buf.readableBytes(), 300u);
+    EXPECT_TRUE(VarintCodec(ignore).encode(&buf));
+    EXPECT_EQ(buf.retrieveAsString(2), "\xac\x02");
+    buf.retrieveAll();
+
+    buf.append("line", 4);
+    EXPECT_TRUE(DelimiterCodec(ignore).encode(&buf));
+    EXPECT_EQ(buf.retrieveAllAsString(), "line\r\n");
+}
+
+/**
+ * @brief 启动服务器, 客户端把 request 分成小块发送后读回 expectedReply 字节, 读完后断开
+ */
+void runEcho(FrameCodec *codec, uint16_t port, const string &request, size_t expectedReply,
+             string *reply, int *maxRecvLowat)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "CodecTest");
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (!conn->connected())
+        {
+            loop.quit();
+        } });
+    server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+                              {
+        codec->onMessage(conn, buf, receiveTime);
+        *maxRecvLowat = max(*maxRecvLowat, conn->recvLowat()); });
+    server.start();
+
+    thread client([&]
+                  {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0)
+        {
+            ::usleep(1000);
+        }
+        // 第一块只有1字节, 帧头被拆开; 之后的大块让大帧跨越多次读取
+        size_t sent = 0;
+        size_t chunk = 1;
+        while (sent < request.size())
+        {
+            size_t n = min(chunk, request.size() - sent);
+            ::write(fd, request.data() + sent, n);
+            sent += n;
+            chunk = chunk == 1 ? 7 : 64 * 1024;
+            ::usleep(2000);
+        }
+        char buf[65536];
+        while (reply->size() < expectedReply)
+        {
+            ssize_t n = ::read(fd, buf, sizeof buf);
+            if (n <= 0)
+            {
+                break;
+            }
+            reply->append(buf, n);
+        }
+        ::close(fd); });
+
+    loop.loop();
+    client.join();
+}
+
+TEST_F(CodecTest, LengthFieldRoundTrip)
+{
+    vector<string> frames;
+    unique_ptr<FrameCodec> codec;
+    codec.reset(new LengthFieldCodec([&](const TcpConnectionPtr &conn, string_view frame, Timestamp)
+                                     {
+        frames.emplace_back(frame);
+        codec->send(conn, frame); }));
+
+    Buffer request;
+    for (const string &payload : {string("hello"), string(), string(1024 * 1024, 'L')})
+    {
+        Buffer frame;
+        frame.append(payload);
+        codec->encode(&frame);
+        request.append(frame.retrieveAllAsString());
+    }
+    string requestBytes = request.retrieveAllAsString();
+
+    string reply;
+    int maxRecvLowat = 0;
+    runEcho(codec.get(), 23461, requestBytes, requestBytes.size(), &reply, &maxRecvLowat);
+
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[0], "hello");
+    EXPECT_EQ(frames[1], "");
+    EXPECT_EQ(frames[2], string(1024 * 1024, 'L'));
+    EXPECT_EQ(reply, requestBytes);
+    // 接收大帧期间提高了低水位
+    EXPECT_GT(maxRecvLowat, static_cast<int>(FrameCodec::kRecvLowatThreshold));
+}
+
+TEST_F(CodecTest, VarintAndDelimiter)
+{
+    vector<string> frames;
+    unique_ptr<FrameCodec> codec;
+    auto echo = [&](const TcpConnectionPtr &conn, string_view frame, Timestamp)
+    {
+        frames.emplace_back(frame);
+        codec->send(conn, frame);
+    };
+
+    codec.reset(new VarintCodec(echo));
+    string request = string("\x05hello\x00\xac\x02", 9) + string(300, 'v');
+    string reply;
+    int maxRecvLowat = 0;
+    runEcho(codec.get(), 23462, request, request.size(), &reply, &maxRecvLowat);
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[0], "hello");
+    EXPECT_EQ(frames[2], string(300, 'v'));
+    EXPECT_EQ(reply, request);
+
+    frames.clear();
+    reply.clear();
+    codec.reset(new DelimiterCodec(echo, "<END>"));
+    request = "first<END>sec<EN<END><END>";
+    runEcho(codec.get(), 23463, request, request.size(), &reply, &maxRecvLowat);
+    EXPECT_EQ(frames, (vector<string>{"first", "sec<EN", ""}));
+    EXPECT_EQ(reply, request);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,269 @@
+#include "net/EventLoop.hpp"
+#include "net/Channel.hpp"
+#include "net/TcpServer.hpp"
+#include "net/poller/IoUringPoller.hpp"
+#include "log/LogStream.hpp"
+#include "base/base.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <gtest/gtest.h>
+
+using namespace schwi;
+using namespace std;
+
+class IoUringPollerTest : public testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        auto logger = make_shared<Logger>(Logger::ERROR, make_shared<LogConsole>());
+        GlobalLogger::Instance().setLogger(logger);
+        ::setenv("TINY_NETWORK_USE_IO_URING", "1", 1);
+    }
+};
+
+// 测试读事件与定时器都能通过 io_uring 正常分发
+TEST_F(IoUringPollerTest, ReadAndTimer)
+{
+    if (!IoUringPoller::available())
+    {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(::pipe2(fds, O_NONBLOCK | O_CLOEXEC), 0);
+
+    int reads = 0;
+    Channel channel(&loop, fds[0]);
+    channel.setReadCallback([&](Timestamp)
+                            {
+        char buf[16];
+        ::read(fds[0], buf, sizeof buf);
+        if (++reads == 2)
+        {
+            loop.quit();
+        } });
+    channel.enableReading();
+
+    loop.runAfter(0.01, [&]
+                  { ::write(fds[1], "a", 1); });
+    loop.runAfter(0.02, [&]
+                  { ::write(fds[1], "b", 1); });
+    loop.loop();
+
+    EXPECT_EQ(reads, 2);
+    channel.disableAll();
+    channel.remove();
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// 测试未读完的数据会再次触发(水平触发语义)以及关注事件的修改
+TEST_F(IoUringPollerTest, LevelTriggeredAndModify)
+{
+    if (!IoUringPoller::available())
+    {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(::pipe2(fds, O_NONBLOCK | O_CLOEXEC), 0);
+    ::write(fds[1], "abc", 3);
+
+    int reads = 0;
+    int writes = 0;
+    Channel reader(&loop, fds[0]);
+    Channel writer(&loop, fds[1]);
+    reader.setReadCallback([&](Timestamp)
+                           {
+        char c;
+        ::read(fds[0], &c, 1);
+        if (++reads == 3)
+        {
+            reader.disableReading();
+            writer.enableWriting();
+        } });
+    writer.setWriteCallback([&]
+                            {
+        ++writes;
+        writer.disableWriting();
+        loop.quit(); });
+    reader.enableReading();
+    loop.loop();
+
+    EXPECT_EQ(reads, 3);
+    EXPECT_EQ(writes, 1);
+    reader.remove();
+    writer.remove();
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// 测试边沿触发的Channel使用多次触发的 POLL_ADD: 多次事件只提交一次请求
+TEST_F(IoUringPollerTest, MultishotEdgeTriggered)
+{
+    if (!IoUringPoller::available())
+    {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    EventLoop loop;
+    IoUringPoller poller(&loop);
+    int fds[2];
+    ASSERT_EQ(::pipe2(fds, O_NONBLOCK | O_CLOEXEC), 0);
+
+    Channel channel(&loop, fds[0]);
+    channel.setEdgeTriggered(true);
+    channel.enableReading();
+    poller.updateChannel(&channel);
+
+    int events = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        ::write(fds[1], "x", 1);
+        Poller::ChannelList active;
+        poller.poll(1000, &active);
+        ASSERT_EQ(active.size(), 1u);
+        EXPECT_EQ(active[0], &channel);
+        ++events;
+        char buf[16];
+        while (::read(fds[0], buf, sizeof buf) > 0)
+        {
+        }
+    }
+
+    EXPECT_EQ(events, 3);
+    EXPECT_EQ(poller.armedPolls(), poller.multishot() ? 1u : 3u);
+    poller.removeChannel(&channel);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// 测试不设置环境变量时也能按 EventLoop 的参数选择 Poller
+TEST_F(IoUringPollerTest, BackendSelection)
+{
+    if (!IoUringPoller::available())
+    {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    ::unsetenv("TINY_NETWORK_USE_IO_URING");
+    {
+        EventLoop defaultLoop;
+        EXPECT_EQ(defaultLoop.ioUring(), nullptr);
+    }
+    {
+        EventLoop uringLoop(PollerBackend::kIoUring);
+        IoUringPoller poller(&uringLoop);
+        EXPECT_EQ(uringLoop.ioUring() != nullptr, poller.completionIo());
+    }
+    ::setenv("TINY_NETWORK_USE_IO_URING", "1", 1);
+    {
+        // 显式指定的后端优先于环境变量
+        EventLoop epollLoop(PollerBackend::kEpoll);
+        EXPECT_EQ(epollLoop.ioUring(), nullptr);
+    }
+}
+
+// 测试基于完成的收发: 连接的读写经由缓冲环上的 recv 与链接的 SEND 完成, 数据按顺序原样回显
+TEST_F(IoUringPollerTest, CompletionEcho)
+{
+    if (!IoUringPoller::available())
+    {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    EventLoop loop(PollerBackend::kIoUring);
+    if (loop.ioUring() == nullptr)
+    {
+        GTEST_SKIP() << "io_uring completion I/O is not supported";
+    }
+
+    const uint16_t port = 23490;
+    const size_t kTotal = 4 * 1024 * 1024;
+    string request(kTotal, '\0');
+    for (size_t i = 0; i < kTotal; ++i)
+    {
+        request[i] = static_cast<char>('a' + i % 26);
+    }
+
+    TcpServer server(&loop, InetAddress(port), "CompletionEcho");
+    server.setThreadNum(1);
+    server.setPollerBackend(PollerBackend::kIoUring);
+    atomic<bool> completionIo(false);
+    atomic<uint64_t> recvs(0);
+    atomic<uint64_t> sends(0);
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            return;
+        }
+        completionIo = conn->completionIo();
+        if (IoUringPoller *ring = conn->getLoop()->ioUring())
+        {
+            recvs = ring->submittedRecvs();
+            sends = ring->submittedSends();
+        }
+        loop.quit(); });
+    server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                              { conn->send(buf); });
+    server.start();
+
+    string received;
+    thread client([&]
+                  {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0)
+        {
+            ::usleep(1000);
+        }
+        thread writer([&]
+                      {
+            size_t sent = 0;
+            while (sent < kTotal)
+            {
+                ssize_t n = ::write(fd, request.data() + sent, kTotal - sent);
+                if (n <= 0)
+                {
+                    break;
+                }
+                sent += n;
+            } });
+        char buf[65536];
+        ssize_t n;
+        while (received.size() < kTotal && (n = ::read(fd, buf, sizeof buf)) > 0)
+        {
+            received.append(buf, n);
+        }
+        writer.join();
+        ::close(fd); });
+
+    loop.loop();
+    client.join();
+
+    EXPECT_TRUE(completionIo);
+    EXPECT_GT(recvs, 0u);
+    EXPECT_GT(sends, 0u);
+    EXPECT_EQ(received.size(), kTotal);
+    EXPECT_TRUE(received == request);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
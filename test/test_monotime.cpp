@@ -0,0 +1,79 @@
+#include "base/MonoTime.hpp"
+#include "net/EventLoop.hpp"
+#include "log/LogStream.hpp"
+#include "base/base.hpp"
+
+#include <cstdlib>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace schwi;
+using namespace std;
+
+TEST(MonoTimeTest, MonoTime)
+{
+    MonoTime t1 = MonoTime::now();
+    this_thread::sleep_for(chrono::milliseconds(2));
+    MonoTime t2 = MonoTime::now();
+
+    EXPECT_TRUE(t1.valid());
+    EXPECT_FALSE(MonoTime::invalid().valid());
+    EXPECT_GE(t2.microseconds() - t1.microseconds(), 2000);
+    EXPECT_LT(t1, addTime(t1, 0.001));
+}
+
+// 测试墙上时间与单调时间的换算
+TEST(MonoTimeTest, Timestamp)
+{
+    Timestamp wall = addTime(Timestamp::now(), 1);
+    MonoTime mono = MonoTime::fromTimestamp(wall);
+    EXPECT_NEAR(mono.microseconds() - MonoTime::now().microseconds(), 1000 * 1000, 1000);
+    EXPECT_NEAR(mono.toTimestamp().microseconds(), wall.microseconds(), 1000);
+}
+
+// 测试TSC时钟与 CLOCK_MONOTONIC 的偏差
+TEST(MonoTimeTest, TscClock)
+{
+    if (!TscClock::enable())
+    {
+        GTEST_SKIP() << "invariant TSC not available";
+    }
+    EXPECT_TRUE(TscClock::enabled());
+    EXPECT_GT(TscClock::cyclesPerMicrosecond(), 0.0);
+
+    MonoTime tsc = MonoTime::now();
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t mono = static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+    EXPECT_NEAR(tsc.microseconds(), mono, 1000);
+
+    TscClock::disable();
+    EXPECT_FALSE(TscClock::enabled());
+}
+
+// 测试loop缓存的时间在每轮poll后刷新
+TEST(MonoTimeTest, EventLoopNow)
+{
+    GlobalLogger::Instance().setLogger(make_shared<Logger>(Logger::ERROR, make_shared<LogConsole>()));
+
+    EventLoop loop;
+    MonoTime first;
+    MonoTime second;
+    loop.runAfter(0.005, [&]
+                  { first = loop.now(); });
+    loop.runAfter(0.02, [&]
+                  {
+        second = loop.now();
+        loop.quit(); });
+    loop.loop();
+
+    EXPECT_TRUE(first.valid());
+    EXPECT_GE(second.microseconds() - first.microseconds(), 10 * 1000);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
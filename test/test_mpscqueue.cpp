@@ -0,0 +1,156 @@
+#include "base/MpscQueue.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace schwi;
+
+struct IntNode : MpscQueueNode
+{
+    explicit IntNode(int v) : value(v) {}
+    int value;
+};
+
+// 测试单线程下先进先出
+TEST(MpscQueueTest, Fifo)
+{
+    MpscQueue<IntNode> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.pop(), nullptr);
+
+    IntNode a(1), b(2), c(3);
+    queue.push(&a);
+    queue.push(&b);
+    EXPECT_EQ(queue.pop()->value, 1);
+    queue.push(&c);
+    EXPECT_EQ(queue.pop()->value, 2);
+    EXPECT_EQ(queue.pop()->value, 3);
+    EXPECT_EQ(queue.pop(), nullptr);
+    EXPECT_TRUE(queue.empty());
+}
+
+// 测试consume只处理调用时刻之前入队的节点
+TEST(MpscQueueTest, ConsumeSnapshot)
+{
+    MpscQueue<IntNode> queue;
+    IntNode a(1), b(2), c(3);
+    queue.push(&a);
+    queue.push(&b);
+
+    vector<int> values;
+    size_t n = queue.consume([&](IntNode *node)
+                             {
+        values.push_back(node->value);
+        if (node->value == 1)
+        {
+            queue.push(&c);
+        } });
+    EXPECT_EQ(n, 2u);
+    EXPECT_EQ(values, (vector<int>{1, 2}));
+    EXPECT_EQ(queue.pop()->value, 3);
+}
+
+// 测试多个生产者并发入队时不丢失节点, 且每个生产者内部保持顺序
+TEST(MpscQueueTest, MultiProducer)
+{
+    const int kProducers = 4;
+    const int kPerProducer = 100000;
+
+    MpscQueue<IntNode> queue;
+    vector<thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back([&, p]
+                               {
+            for (int i = 0; i < kPerProducer; ++i)
+            {
+                queue.push(new IntNode(p * kPerProducer + i));
+            } });
+    }
+
+    vector<int> last(kProducers, -1);
+    int received = 0;
+    while (received < kProducers * kPerProducer)
+    {
+        IntNode *node = queue.pop();
+        if (node == nullptr)
+        {
+            this_thread::yield();
+            continue;
+        }
+        int p = node->value / kPerProducer;
+        EXPECT_LT(last[p], node->value);
+        last[p] = node->value;
+        ++received;
+        delete node;
+    }
+
+    for (auto &t : producers)
+    {
+        t.join();
+    }
+    EXPECT_EQ(queue.pop(), nullptr);
+}
+
+// 测试生产者入队期间并发调用consume, 所有节点恰好处理一次;
+// 每轮生产者结束后一次consume即可取空队列 (pop重新入队_stub时不能误判为空)
+TEST(MpscQueueTest, ConcurrentConsume)
+{
+    const int kRounds = 500;
+    const int kProducers = 2;
+    const int kPerProducer = 64;
+
+    MpscQueue<IntNode> queue;
+    vector<int> last(kProducers, -1);
+    int received = 0;
+    auto handle = [&](IntNode *node)
+    {
+        int p = node->value % kProducers;
+        EXPECT_LT(last[p], node->value);
+        last[p] = node->value;
+        ++received;
+        delete node;
+    };
+
+    for (int round = 0; round < kRounds; ++round)
+    {
+        atomic<int> running{kProducers};
+        vector<thread> producers;
+        for (int p = 0; p < kProducers; ++p)
+        {
+            producers.emplace_back([&, p]
+                                   {
+                for (int i = 0; i < kPerProducer; ++i)
+                {
+                    int seq = round * kPerProducer + i;
+                    queue.push(new IntNode(seq * kProducers + p));
+                }
+                running.fetch_sub(1); });
+        }
+        while (running.load() > 0)
+        {
+            if (queue.consume(handle) == 0)
+            {
+                this_thread::yield();
+            }
+        }
+        for (auto &t : producers)
+        {
+            t.join();
+        }
+
+        queue.consume(handle);
+        ASSERT_EQ(received, (round + 1) * kProducers * kPerProducer);
+    }
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.pop(), nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,1054 @@
+#include "net/TcpServer.hpp"
+#include "net/Buffer.hpp"
+#include "net/BufferPool.hpp"
+#include "log/LogStream.hpp"
+#include "base/base.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+using namespace schwi;
+using namespace std;
+
+class TcpConnectionTest : public testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        auto logger = make_shared<Logger>(Logger::ERROR, make_shared<LogConsole>());
+        GlobalLogger::Instance().setLogger(logger);
+    }
+};
+
+/**
+ * @brief 启动服务器, 连接建立时调用 onUp, 客户端读到对端关闭为止
+ * @return 客户端收到的全部数据
+ */
+string runServer(uint16_t port, const function<void(const TcpConnectionPtr &)> &onUp)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "TcpConnectionTest");
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            onUp(conn);
+        }
+        else
+        {
+            loop.quit();
+        } });
+    server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+                              { buf->retrieveAll(); });
+    server.start();
+
+    string received;
+    thread client([&]
+                  {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0)
+        {
+            ::usleep(1000);
+        }
+        char buf[65536];
+        ssize_t n;
+        while ((n = ::read(fd, buf, sizeof buf)) > 0)
+        {
+            received.append(buf, n);
+        }
+        ::close(fd); });
+
+    loop.loop();
+    client.join();
+    return received;
+}
+
+// 测试文件与内存数据按顺序发送, 并触发高水位与写完成回调
+TEST_F(TcpConnectionTest, SendFile)
+{
+    char path[] = "/tmp/tiny_network_sendfileXXXXXX";
+    int fd = ::mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ::unlink(path);
+    string content;
+    for (int i = 0; content.size() < 16 * 1024 * 1024; ++i)
+    {
+        content += to_string(i) + ',';
+    }
+    ASSERT_EQ(::write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+    int highWaterMarks = 0;
+    int writeCompletes = 0;
+    string received = runServer(23471, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->setHighWaterMarkCallback([&](const TcpConnectionPtr &, size_t)
+                                       { ++highWaterMarks; },
+                                       1024 * 1024);
+        conn->setWriteCompleteCallback([&](const TcpConnectionPtr &)
+                                       { ++writeCompletes; });
+        conn->send("HEAD");
+        conn->sendFile(fd, 100, content.size() - 100);
+        conn->send("TAIL");
+        conn->shutdown(); });
+    ::close(fd);
+
+    EXPECT_EQ(received, "HEAD" + content.substr(100) + "TAIL");
+    EXPECT_EQ(highWaterMarks, 1);
+    EXPECT_GE(writeCompletes, 1);
+}
+
+// 测试 sendfile 不支持的fd(管道)改用 splice 发送
+TEST_F(TcpConnectionTest, SendFileFromPipe)
+{
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    string content(10000, 'p');
+    ASSERT_EQ(::write(fds[1], content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    ::close(fds[1]);
+
+    string received = runServer(23472, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->sendFile(fds[0], 0, content.size());
+        conn->shutdown(); });
+    ::close(fds[0]);
+
+    EXPECT_EQ(received, content);
+}
+
+// 测试文件比声明的长度短时不再发送之后的数据并关闭连接, 对端不会把后续数据当作文件内容
+TEST_F(TcpConnectionTest, SendFileEndsEarly)
+{
+    char path[] = "/tmp/tiny_network_sendfileXXXXXX";
+    int fd = ::mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ::unlink(path);
+    string content(1000, 'f');
+    ASSERT_EQ(::write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+
+    int writeCompletes = 0;
+    string received = runServer(23489, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->setWriteCompleteCallback([&](const TcpConnectionPtr &)
+                                       { ++writeCompletes; });
+        conn->sendFile(fd, 0, 5000);
+        conn->send("TAIL"); });
+    ::close(fd);
+
+    EXPECT_EQ(received, content);
+    EXPECT_EQ(writeCompletes, 0);
+}
+
+/**
+ * @brief 进程到目前为止消耗的CPU时间(毫秒)
+ */
+long cpuMillis()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+}
+
+// 测试socket不能直接 splice 到socket, 经中转管道发送, 数据稍后才到也不会丢失
+TEST_F(TcpConnectionTest, SendFileFromSocket)
+{
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    string first(10000, 's');
+    string second(200000, 't');
+    ASSERT_EQ(::write(fds[1], first.data(), first.size()), static_cast<ssize_t>(first.size()));
+
+    thread writer([&]
+                  {
+        ::usleep(200 * 1000);
+        size_t written = 0;
+        while (written < second.size())
+        {
+            ssize_t n = ::write(fds[1], second.data() + written, second.size() - written);
+            if (n <= 0)
+            {
+                break;
+            }
+            written += n;
+        }
+        ::close(fds[1]); });
+
+    string received = runServer(23485, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->sendFile(fds[0], 0, first.size() + second.size());
+        conn->send("TAIL");
+        conn->shutdown(); });
+    writer.join();
+    ::close(fds[0]);
+
+    EXPECT_EQ(received, first + second + "TAIL");
+}
+
+// 测试空的非阻塞管道等待其可读再发送, 等待期间不因可写事件空转
+TEST_F(TcpConnectionTest, SendFileFromEmptyPipe)
+{
+    int fds[2];
+    ASSERT_EQ(::pipe2(fds, O_NONBLOCK), 0);
+    string content(10000, 'e');
+
+    thread writer([&]
+                  {
+        ::usleep(300 * 1000);
+        ::write(fds[1], content.data(), content.size());
+        ::close(fds[1]); });
+
+    long cpuBefore = cpuMillis();
+    string received = runServer(23486, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->sendFile(fds[0], 0, content.size());
+        conn->shutdown(); });
+    long cpuUsed = cpuMillis() - cpuBefore;
+    writer.join();
+    ::close(fds[0]);
+
+    EXPECT_EQ(received, content);
+    EXPECT_LT(cpuUsed, 150);
+}
+
+// 测试链式 Buffer 中的外部内存以 MSG_ZEROCOPY 发送, 完成通知不当作错误并释放内存
+TEST_F(TcpConnectionTest, ZeroCopy)
+{
+    const size_t kSize = 8 * 1024 * 1024;
+    shared_ptr<char[]> payload(new char[kSize]);
+    for (size_t i = 0; i < kSize; ++i)
+    {
+        payload[i] = static_cast<char>('a' + i % 26);
+    }
+
+    bool supported = true;
+    size_t pendingAtClose = 0;
+    TcpConnectionPtr server;
+    string received = runServer(23473, [&](const TcpConnectionPtr &conn)
+                                {
+        server = conn;
+        conn->setZeroCopyThreshold(64 * 1024);
+        supported = conn->zeroCopyThreshold() > 0;
+        Buffer buf;
+        buf.setChained(true);
+        buf.append("head", 4);
+        buf.append(shared_ptr<const char[]>(payload), kSize);
+        conn->send(&buf);
+        conn->shutdown(); });
+    pendingAtClose = server->zeroCopyPending();
+    server.reset();
+    if (!supported)
+    {
+        GTEST_SKIP() << "SO_ZEROCOPY is not supported";
+    }
+
+    EXPECT_EQ(received, "head" + string(payload.get(), kSize));
+    EXPECT_EQ(pendingAtClose, 0u);
+    EXPECT_EQ(payload.use_count(), 1);
+}
+
+// 测试多段内存的发送: 直接 writev, 没写完的部分在链式模式下只持有 owner, 以及跨线程发送
+TEST_F(TcpConnectionTest, SendIovec)
+{
+    const size_t kSize = 8 * 1024 * 1024;
+    auto body = make_shared<const string>(kSize, 'b');
+    long useCountAfterSend = 0;
+    string received = runServer(23474, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->setChainedOutput(true);
+        string head = "head:";
+        const iovec borrowed[] = {{head.data(), head.size()}, {const_cast<char *>("mid:"), 4}};
+        conn->send(borrowed);
+
+        const iovec owned[] = {{const_cast<char *>(body->data()), body->size()}, {const_cast<char *>(":tail"), 5}};
+        conn->send(owned, body);
+        useCountAfterSend = body.use_count();
+
+        thread([conn, body]
+               {
+            const iovec remote[] = {{const_cast<char *>(":remote"), 7}};
+            conn->send(remote, body);
+            conn->shutdown(); })
+            .join(); });
+
+    EXPECT_EQ(received, "head:mid:" + *body + ":tail:remote");
+    // 大块数据没有一次写完, 输出缓冲持有 owner 而不是拷贝
+    EXPECT_GT(useCountAfterSend, 1);
+    EXPECT_EQ(body.use_count(), 1);
+}
+
+// 测试在其他线程中移动发送字符串和 Buffer, 以及投递只能移动的回调
+TEST_F(TcpConnectionTest, SendMoveAcrossThreads)
+{
+    const size_t kSize = 4 * 1024 * 1024;
+    auto payload = make_shared<const string>(kSize, 'c');
+    string received = runServer(23475, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->setChainedOutput(true);
+        thread([conn, payload]
+               {
+            conn->send(string(kSize, 's'));
+
+            Buffer contiguous;
+            contiguous.append("contiguous", 10);
+            conn->send(std::move(contiguous));
+
+            // 使用内存池的缓冲区跨线程发送后仍属于原内存池, 内存从池中取出移走而不是拷贝
+            BufferPool pool;
+            Buffer pooled(&pool);
+            pooled.append("pooled", 6);
+            EXPECT_GT(pool.borrowedBytes(), 0u);
+            conn->send(&pooled);
+            EXPECT_EQ(pooled.readableBytes(), 0u);
+            EXPECT_EQ(pooled.pool(), &pool);
+            EXPECT_EQ(pool.borrowedBytes(), 0u);
+
+            Buffer chained;
+            chained.setChained(true);
+            chained.append(shared_ptr<const void>(payload), payload->data(), payload->size());
+            conn->send(&chained);
+            EXPECT_EQ(chained.readableBytes(), 0u);
+
+            auto tail = make_unique<string>("tail");
+            conn->getLoop()->runInLoop([conn, tail = std::move(tail)]
+                                       {
+                conn->send(*tail);
+                conn->shutdown(); }); })
+            .join(); });
+
+    EXPECT_EQ(received, string(kSize, 's') + "contiguous" + "pooled" + *payload + "tail");
+    EXPECT_EQ(payload.use_count(), 1);
+}
+
+// 测试读背压: 客户端只写不读时回显服务暂停读取, 输出积压有上界, 客户端开始读后恢复
+TEST_F(TcpConnectionTest, ReadBackpressure)
+{
+    const uint16_t port = 23476;
+    const size_t kTotal = 32 * 1024 * 1024;
+    const size_t kHigh = 1024 * 1024;
+    string request(kTotal, '\0');
+    for (size_t i = 0; i < kTotal; ++i)
+    {
+        request[i] = static_cast<char>('a' + i % 26);
+    }
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "ReadBackpressure");
+    int pauses = 0;
+    size_t maxBacklog = 0;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            conn->setReadBackpressure(kHigh, kHigh / 4);
+            conn->setHighWaterMarkCallback([&](const TcpConnectionPtr &, size_t len)
+                                           { maxBacklog = max(maxBacklog, len); },
+                                           kHigh);
+        }
+        else
+        {
+            loop.quit();
+        } });
+    server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                              {
+        conn->send(buf);
+        if (!conn->isReading())
+        {
+            ++pauses;
+        } });
+    server.start();
+
+    string received;
+    thread client([&]
+                  {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0)
+        {
+            ::usleep(1000);
+        }
+        thread writer([&]
+                      {
+            size_t sent = 0;
+            while (sent < kTotal)
+            {
+                ssize_t n = ::write(fd, request.data() + sent, min<size_t>(kTotal - sent, 256 * 1024));
+                if (n <= 0)
+                {
+                    break;
+                }
+                sent += n;
+            } });
+        // 先不读, 让服务器的输出积压到高水位
+        ::usleep(200 * 1000);
+        char buf[65536];
+        ssize_t n;
+        while (received.size() < kTotal && (n = ::read(fd, buf, sizeof buf)) > 0)
+        {
+            received.append(buf, n);
+        }
+        writer.join();
+        ::close(fd); });
+
+    loop.loop();
+    client.join();
+
+    EXPECT_EQ(received.size(), kTotal);
+    EXPECT_TRUE(received == request);
+    EXPECT_GT(pauses, 0);
+    // 暂停后积压最多再增加一次读取的数据
+    EXPECT_LT(maxBacklog, kHigh + 1024 * 1024);
+}
+
+// 测试 cork 模式: 多次发送在本轮末尾合并写出, shutdown 等缓存的数据写完再关闭
+TEST_F(TcpConnectionTest, Cork)
+{
+    string expected;
+    for (int i = 0; i < 1000; ++i)
+    {
+        expected += "+" + to_string(i) + "\r\n";
+    }
+    expected += string(4 * 1024 * 1024, 'k');
+
+    bool corked = false;
+    int writeCompletes = 0;
+    string received = runServer(23477, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->setCorked(true);
+        corked = conn->corked();
+        conn->setWriteCompleteCallback([&](const TcpConnectionPtr &)
+                                       { ++writeCompletes; });
+        for (int i = 0; i < 1000; ++i)
+        {
+            conn->send("+");
+            conn->send(to_string(i));
+            conn->send("\r\n");
+        }
+        conn->send(string(4 * 1024 * 1024, 'k'));
+        conn->shutdown(); });
+
+    EXPECT_TRUE(corked);
+    EXPECT_EQ(received, expected);
+    EXPECT_EQ(writeCompletes, 1);
+}
+
+// 测试 TCP_NOTSENT_LOWAT: 内核中未发出的数据不超过低水位太多, 其余留在输出缓冲
+TEST_F(TcpConnectionTest, NotSentLowat)
+{
+    const int kLowat = 16 * 1024;
+    const string content(8 * 1024 * 1024, 'n');
+    int lowat = 0;
+    int unsent = -1;
+    string received = runServer(23478, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->setNotSentLowat(kLowat);
+        lowat = conn->notSentLowat();
+        conn->send(content);
+        unsent = conn->unsentBytes();
+        conn->shutdown(); });
+
+    EXPECT_EQ(lowat, kLowat);
+    EXPECT_GE(unsent, 0);
+    // 每次分配新的skb前检查, 最多超出一个skb
+    EXPECT_LE(unsent, kLowat + 64 * 1024);
+    EXPECT_EQ(received, content);
+}
+
+// 测试按令牌桶限速发送: 用完突发额度后按速率发送, 数据顺序不变
+TEST_F(TcpConnectionTest, SendRateLimit)
+{
+    const size_t kRate = 1024 * 1024;
+    const size_t kBurst = 64 * 1024;
+    string content;
+    for (int i = 0; content.size() < 512 * 1024; ++i)
+    {
+        content += to_string(i) + ';';
+    }
+
+    auto start = chrono::steady_clock::now();
+    string received = runServer(23479, [&](const TcpConnectionPtr &conn)
+                                {
+        conn->setSendRateLimit(kRate, kBurst);
+        conn->send(content);
+        conn->shutdown(); });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(received, content);
+    double expected = static_cast<double>(content.size() - kBurst) / kRate;
+    EXPECT_GT(seconds, expected * 0.8);
+    EXPECT_LT(seconds, expected * 2 + 0.5);
+}
+
+/**
+ * @brief 连接到本机端口, 失败时重试
+ */
+int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0)
+    {
+        ::usleep(1000);
+    }
+    return fd;
+}
+
+// 测试共用令牌桶的队首停止取令牌时让出位置, 排在后面的等待时间按位置计算
+TEST_F(TcpConnectionTest, SharedSendTurnSkipsStalledHead)
+{
+    TokenBucket bucket(1000, 1000);
+    TokenBucket::Waiter a, b;
+    MonoTime t0 = MonoTime::now();
+    ASSERT_EQ(bucket.acquire(1000, t0), 1000u);
+
+    EXPECT_EQ(bucket.acquire(100, t0, 100, &a), 0u);
+    EXPECT_EQ(bucket.acquire(100, t0, 100, &b), 0u);
+    EXPECT_TRUE(a.queued && b.queued);
+    // a 需要 0.1 秒, b 要等 a 取走之后再等 0.1 秒
+    EXPECT_NEAR(bucket.delay(100, t0, &a), 0.1, 0.01);
+    EXPECT_NEAR(bucket.delay(100, t0, &b), 0.2, 0.01);
+
+    // a 的令牌已够用但还在期限内, b 仍然取不到
+    EXPECT_EQ(bucket.acquire(100, addTime(t0, 0.15), 100, &b), 0u);
+    EXPECT_TRUE(a.queued);
+
+    // a 超过一个补充周期没有回来, b 取得令牌, a 回来后排到队尾
+    EXPECT_EQ(bucket.acquire(100, addTime(t0, 0.25), 100, &b), 100u);
+    EXPECT_FALSE(a.queued);
+    EXPECT_FALSE(b.queued);
+    EXPECT_EQ(bucket.acquire(100, addTime(t0, 0.25), 100, &a), 100u);
+}
+
+// 测试共用总带宽时两个大流量连接都能取得令牌, 先开始发送的连接不会独占
+TEST_F(TcpConnectionTest, SharedSendRateFairness)
+{
+    const uint16_t port = 23483;
+    const double kTotalRate = 512 * 1024;
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "SharedSendRateFairness");
+    server.setSendRateLimit(0, kTotalRate);
+    int disconnects = 0;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            conn->send(string(4 * 1024 * 1024, 'f'));
+        }
+        else if (++disconnects == 2)
+        {
+            loop.quit();
+        } });
+    server.start();
+
+    size_t received[2] = {0, 0};
+    thread client([&]
+                  {
+        int fds[2];
+        for (int &fd : fds)
+        {
+            fd = connectTo(port);
+            ::usleep(20 * 1000);
+        }
+        auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+        char buf[65536];
+        while (chrono::steady_clock::now() < deadline)
+        {
+            pollfd pfds[2] = {{fds[0], POLLIN, 0}, {fds[1], POLLIN, 0}};
+            ::poll(pfds, 2, 10);
+            for (int i = 0; i < 2; ++i)
+            {
+                if (pfds[i].revents & POLLIN)
+                {
+                    ssize_t n = ::read(fds[i], buf, sizeof buf);
+                    if (n > 0)
+                    {
+                        received[i] += n;
+                    }
+                }
+            }
+        }
+        for (int fd : fds)
+        {
+            ::close(fd);
+        } });
+    loop.loop();
+    client.join();
+
+    size_t total = received[0] + received[1];
+    EXPECT_LT(total, kTotalRate * 1.5 + 128 * 1024);
+    EXPECT_GT(received[0], total / 4);
+    EXPECT_GT(received[1], total / 4);
+}
+
+// 测试空闲超时: 持续有数据时不关闭, 停止发送后在超时后的两秒内被服务器关闭
+TEST_F(TcpConnectionTest, IdleTimeout)
+{
+    const uint16_t port = 23480;
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "IdleTimeout");
+    server.setTimeouts(1);
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (!conn->connected())
+        {
+            // 强制关闭的socket在连接对象销毁时才关闭, 等销毁后再退出
+            loop.queueInLoop([&]
+                             { loop.quit(); });
+        } });
+    server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+                              { buf->retrieveAll(); });
+    server.start();
+
+    double activeSeconds = 0;
+    double idleSeconds = 0;
+    thread client([&]
+                  {
+        int fd = connectTo(port);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < 8; ++i)
+        {
+            ::write(fd, "x", 1);
+            ::usleep(300 * 1000);
+        }
+        auto lastWrite = chrono::steady_clock::now();
+        activeSeconds = chrono::duration<double>(lastWrite - start).count();
+        char buf[16];
+        while (::read(fd, buf, sizeof buf) > 0)
+        {
+        }
+        idleSeconds = chrono::duration<double>(chrono::steady_clock::now() - lastWrite).count();
+        ::close(fd); });
+    loop.loop();
+    client.join();
+
+    EXPECT_GT(activeSeconds, 2.0);
+    EXPECT_GE(idleSeconds, 0.7); // 最后一次写出后还在 usleep 中等了 0.3 秒
+    EXPECT_LT(idleSeconds, 3.5);
+}
+
+// 测试fd接近上限时淘汰最久没有活动的连接
+TEST_F(TcpConnectionTest, EvictNearFdLimit)
+{
+    const uint16_t port = 23481;
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "EvictNearFdLimit");
+
+    // 以下一个可用的fd为基准: 客户端与服务器的socket交替占用, 第三个连接的服务器端fd为 next + 5
+    int next = ::dup(0);
+    ::close(next);
+    struct rlimit limit;
+    ASSERT_EQ(::getrlimit(RLIMIT_NOFILE, &limit), 0);
+    server.setEvictWhenNearFdLimit((next + 4.5) / static_cast<double>(limit.rlim_cur));
+
+    int disconnects = 0;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (!conn->connected() && ++disconnects == 3)
+        {
+            loop.quit();
+        } });
+    server.start();
+
+    bool firstEvicted = false;
+    bool secondOpen = false;
+    thread client([&]
+                  {
+        int fds[3];
+        for (int &fd : fds)
+        {
+            fd = connectTo(port);
+            ::usleep(50 * 1000);
+        }
+        timeval timeout{2, 0};
+        ::setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        char buf[16];
+        firstEvicted = ::read(fds[0], buf, sizeof buf) == 0;
+        pollfd pfd{fds[1], POLLIN, 0};
+        secondOpen = ::poll(&pfd, 1, 200) == 0;
+        for (int fd : fds)
+        {
+            ::close(fd);
+        } });
+    loop.loop();
+    client.join();
+
+    EXPECT_TRUE(firstEvicted);
+    EXPECT_TRUE(secondOpen);
+}
+
+// 测试 accept 遇到 EMFILE 时淘汰所有loop中最久没有活动的连接, 而不只是下一个连接将分到的loop
+TEST_F(TcpConnectionTest, EvictOnAcceptEmfile)
+{
+    const uint16_t port = 23484;
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "EvictOnAcceptEmfile");
+    server.setThreadNum(2);
+    server.setEvictWhenNearFdLimit(1.0); // 只由 EMFILE 触发淘汰
+
+    atomic<int> disconnects{0};
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            conn->send("ok");
+        }
+        else if (++disconnects == 4)
+        {
+            loop.queueInLoop([&]
+                             { loop.quit(); });
+        } });
+    server.start();
+
+    // 以下一个可用的fd为基准, 只留7个: 前三个连接占6个, 第四个连接的客户端socket占最后一个, accept 时 EMFILE
+    int next = ::dup(0);
+    ::close(next);
+    struct rlimit saved;
+    ASSERT_EQ(::getrlimit(RLIMIT_NOFILE, &saved), 0);
+    struct rlimit limit = saved;
+    limit.rlim_cur = next + 7;
+    ASSERT_EQ(::setrlimit(RLIMIT_NOFILE, &limit), 0);
+    // accept 失败时每轮都会打印错误日志
+    GlobalLogger::Instance().setLogger(make_shared<Logger>(Logger::FATAL, make_shared<LogConsole>()));
+
+    bool firstEvicted = false;
+    bool secondOpen = false;
+    bool fourthAccepted = false;
+    thread client([&]
+                  {
+        // 连接按轮询分到两个loop: 第一、三个在loop0, 第二、四个在loop1; 第一个连接的活动时刻早一秒以上
+        int fds[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            fds[i] = connectTo(port);
+            ::usleep(i == 0 ? 1100 * 1000 : 50 * 1000);
+        }
+        timeval timeout{3, 0};
+        char buf[16];
+        for (int fd : fds)
+        {
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        }
+        fourthAccepted = ::read(fds[3], buf, sizeof buf) == 2;
+        firstEvicted = ::read(fds[0], buf, sizeof buf) == 2 && ::read(fds[0], buf, sizeof buf) == 0;
+        pollfd pfd{fds[1], POLLIN, 0};
+        secondOpen = ::read(fds[1], buf, sizeof buf) == 2 && ::poll(&pfd, 1, 200) == 0;
+        for (int fd : fds)
+        {
+            ::close(fd);
+        } });
+    loop.loop();
+    client.join();
+    ::setrlimit(RLIMIT_NOFILE, &saved);
+    GlobalLogger::Instance().setLogger(make_shared<Logger>(Logger::ERROR, make_shared<LogConsole>()));
+
+    EXPECT_TRUE(fourthAccepted);
+    EXPECT_TRUE(firstEvicted);
+    EXPECT_TRUE(secondOpen);
+}
+
+// 测试忙轮询: 自旋窗口内等到的事件计为命中, 自旋超时后转入阻塞计为未命中
+TEST_F(TcpConnectionTest, BusyPollSpin)
+{
+    {
+        EventLoop loop;
+        loop.setBusyPoll(200 * 1000);
+        thread poster([&]
+                      {
+            for (int i = 0; i < 10; ++i)
+            {
+                loop.queueInLoop([] {});
+                ::usleep(1000);
+            }
+            loop.queueInLoop([&]
+                             { loop.quit(); }); });
+        loop.loop();
+        poster.join();
+        EXPECT_GT(loop.spinHits(), 0u);
+        EXPECT_EQ(loop.spinMisses(), 0u);
+    }
+    {
+        EventLoop loop;
+        loop.setBusyPoll(1000);
+        loop.runAfter(0.05, [&]
+                      { loop.quit(); });
+        loop.loop();
+        EXPECT_GE(loop.spinMisses(), 1u);
+    }
+}
+
+// 测试不使用timerfd时, 自旋不超过定时器给出的poll超时, 到期的定时器不被推迟
+TEST_F(TcpConnectionTest, BusyPollTimerTimeout)
+{
+    EventLoop loop;
+    loop.disableTimerfd();
+    loop.setBusyPoll(1000 * 1000);
+    auto start = chrono::steady_clock::now();
+    double elapsed = 0;
+    loop.runAfter(0.02, [&]
+                  {
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        loop.quit(); });
+    loop.loop();
+
+    EXPECT_GE(elapsed, 0.02);
+    EXPECT_LT(elapsed, 0.3);
+    EXPECT_EQ(loop.spinMisses(), 0u);
+}
+
+/**
+ * @brief 在本进程的fd中查找对端为 peer 的socket, 返回其 SO_BUSY_POLL
+ */
+int busyPollOfPeer(const InetAddress &peer)
+{
+    for (int fd = 0; fd < 1024; ++fd)
+    {
+        sockaddr_in addr{};
+        socklen_t len = sizeof addr;
+        if (::getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &len) == 0 &&
+            addr.sin_port == peer.getSockAddr()->sin_port &&
+            addr.sin_addr.s_addr == peer.getSockAddr()->sin_addr.s_addr)
+        {
+            int value = -1;
+            len = sizeof value;
+            ::getsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &value, &len);
+            return value;
+        }
+    }
+    return -1;
+}
+
+// 测试线程数为0时 TcpServer::setBusyPoll 作用于base loop, 新连接设置 SO_BUSY_POLL
+TEST_F(TcpConnectionTest, BusyPollSocketOption)
+{
+    const uint16_t port = 23482;
+    const int kSocketBusyPoll = 50;
+    int probe = ::socket(AF_INET, SOCK_STREAM, 0);
+    int ret = ::setsockopt(probe, SOL_SOCKET, SO_BUSY_POLL, &kSocketBusyPoll, sizeof kSocketBusyPoll);
+    ::close(probe);
+    if (ret != 0)
+    {
+        GTEST_SKIP() << "SO_BUSY_POLL requires CAP_NET_ADMIN";
+    }
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "BusyPollSocketOption");
+    server.setBusyPoll(100, kSocketBusyPoll);
+    int value = -1;
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            value = busyPollOfPeer(conn->peerAddress());
+            conn->shutdown();
+        }
+        else
+        {
+            loop.quit();
+        } });
+    server.start();
+
+    thread client([&]
+                  {
+        int fd = connectTo(port);
+        char buf[16];
+        while (::read(fd, buf, sizeof buf) > 0)
+        {
+        }
+        ::close(fd); });
+    loop.loop();
+    client.join();
+
+    EXPECT_EQ(loop.busyPollMicros(), 100);
+    EXPECT_EQ(value, kSocketBusyPoll);
+}
+
+/**
+ * @brief 把日志保存到字符串, 用于检查是否输出了某条错误
+ */
+class LogCapture : public ILogStreamBase
+{
+public:
+    void append(const char *buf, size_t len) override
+    {
+        lock_guard<mutex> lock(_mutex);
+        _text.append(buf, len);
+    }
+    void flush() override {}
+
+    string text()
+    {
+        lock_guard<mutex> lock(_mutex);
+        return _text;
+    }
+
+private:
+    mutex _mutex;
+    string _text;
+};
+
+/**
+ * @brief 发送一段以 MSG_ZEROCOPY 发送的外部内存, 调用方只保留其弱引用
+ */
+void sendZeroCopyPayload(const TcpConnectionPtr &conn, size_t size, weak_ptr<char[]> *weak)
+{
+    shared_ptr<char[]> payload(new char[size]);
+    for (size_t i = 0; i < size; ++i)
+    {
+        payload[i] = static_cast<char>('a' + i % 26);
+    }
+    *weak = payload;
+    Buffer buf;
+    buf.setChained(true);
+    buf.append(shared_ptr<const char[]>(std::move(payload)), size);
+    conn->send(&buf);
+}
+
+// 测试连接销毁时未收到完成通知的 MSG_ZEROCOPY 内存继续保留, 对端读完后才释放
+TEST_F(TcpConnectionTest, ZeroCopyOutlivesConnection)
+{
+    const uint16_t port = 23487;
+    const size_t kSize = 8 * 1024 * 1024;
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "ZeroCopyOutlivesConnection");
+    weak_ptr<char[]> weak;
+    bool supported = true;
+    bool aliveAfterDestroy = false;
+    atomic_bool startReading{false};
+    atomic_bool clientDone{false};
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            conn->setZeroCopyThreshold(64 * 1024);
+            supported = conn->zeroCopyThreshold() > 0;
+            sendZeroCopyPayload(conn, kSize, &weak);
+            conn->forceClose();
+        }
+        else
+        {
+            // 连接在本轮之后销毁, 稍后检查内存是否仍然有效
+            loop.runAfter(0.1, [&]
+                          {
+                aliveAfterDestroy = !weak.expired();
+                startReading = true; });
+        } });
+    server.start();
+
+    size_t received = 0;
+    thread client([&]
+                  {
+        int fd = connectTo(port);
+        while (!startReading)
+        {
+            ::usleep(1000);
+        }
+        char buf[65536];
+        ssize_t n;
+        while ((n = ::read(fd, buf, sizeof buf)) > 0)
+        {
+            received += n;
+        }
+        ::close(fd);
+        clientDone = true; });
+
+    loop.runEvery(0.01, [&]
+                  {
+        if (clientDone && weak.expired())
+        {
+            loop.quit();
+        } });
+    loop.runAfter(10, [&]
+                  { loop.quit(); });
+    loop.loop();
+    client.join();
+    if (!supported)
+    {
+        GTEST_SKIP() << "SO_ZEROCOPY is not supported";
+    }
+
+    EXPECT_TRUE(aliveAfterDestroy);
+    EXPECT_GT(received, 0u);
+    EXPECT_TRUE(weak.expired());
+}
+
+// 测试完成通知与对端 RST 同时到达时, 错误仍然交给 handleError 输出
+TEST_F(TcpConnectionTest, ZeroCopyNotificationKeepsSocketError)
+{
+    const uint16_t port = 23488;
+    auto capture = make_shared<LogCapture>();
+    GlobalLogger::Instance().setLogger(make_shared<Logger>(Logger::ERROR, capture));
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "ZeroCopyNotificationKeepsSocketError");
+    weak_ptr<char[]> weak;
+    bool supported = true;
+    atomic_bool sent{false};
+    server.setConnectionCallback([&](const TcpConnectionPtr &conn)
+                                 {
+        if (conn->connected())
+        {
+            conn->setZeroCopyThreshold(64 * 1024);
+            supported = conn->zeroCopyThreshold() > 0;
+            sendZeroCopyPayload(conn, 8 * 1024 * 1024, &weak);
+            sent = true;
+        }
+        else
+        {
+            loop.quit();
+        } });
+    server.start();
+
+    thread client([&]
+                  {
+        int fd = connectTo(port);
+        while (!sent)
+        {
+            ::usleep(1000);
+        }
+        ::usleep(50 * 1000);
+        // 不读取数据直接以 RST 关闭, 服务端的待发数据被丢弃并收到完成通知
+        struct linger lg = {1, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+        ::close(fd); });
+
+    loop.runAfter(10, [&]
+                  { loop.quit(); });
+    loop.loop();
+    client.join();
+    GlobalLogger::Instance().setLogger(make_shared<Logger>(Logger::ERROR, make_shared<LogConsole>()));
+    if (!supported)
+    {
+        GTEST_SKIP() << "SO_ZEROCOPY is not supported";
+    }
+
+    EXPECT_NE(capture->text().find("SO_ERROR = " + to_string(ECONNRESET)), string::npos) << capture->text();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
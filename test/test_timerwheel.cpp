@@ -0,0 +1,134 @@
+#include "net/EventLoop.hpp"
+#include "log/LogStream.hpp"
+#include "base/base.hpp"
+
+#include <vector>
+#include <tuple>
+
+#include <gtest/gtest.h>
+
+using namespace schwi;
+using namespace std;
+
+class TimerTest : public testing::TestWithParam<tuple<bool, bool>>
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        auto logger = make_shared<Logger>(Logger::ERROR, make_shared<LogConsole>());
+        GlobalLogger::Instance().setLogger(logger);
+    }
+
+    void SetUp() override
+    {
+        auto [useWheel, useTimerfd] = GetParam();
+        if (!useTimerfd)
+        {
+            _loop.disableTimerfd();
+        }
+        if (useWheel)
+        {
+            _loop.useTimerWheel(0.001);
+        }
+    }
+
+    EventLoop _loop;
+};
+
+// 测试定时器按超时时刻顺序执行
+TEST_P(TimerTest, Order)
+{
+    vector<int> order;
+    _loop.runAfter(0.03, [&]
+                   { order.push_back(3); _loop.quit(); });
+    _loop.runAfter(0.01, [&]
+                   { order.push_back(1); });
+    _loop.runAfter(0.02, [&]
+                   { order.push_back(2); });
+    _loop.loop();
+
+    EXPECT_EQ(order, (vector<int>{1, 2, 3}));
+}
+
+// 测试取消尚未执行的定时器, 以及取消已失效的TimerId
+TEST_P(TimerTest, Cancel)
+{
+    bool fired = false;
+    TimerId once = _loop.runAfter(0.001, [] {});
+    TimerId canceled = _loop.runAfter(0.01, [&]
+                                      { fired = true; });
+    _loop.cancel(canceled);
+    _loop.runAfter(0.03, [&]
+                   {
+        _loop.cancel(once);
+        _loop.cancel(canceled);
+        _loop.quit(); });
+    _loop.loop();
+
+    EXPECT_FALSE(fired);
+}
+
+// 测试重复定时器在回调中取消自身
+TEST_P(TimerTest, CancelSelf)
+{
+    int count = 0;
+    TimerId every;
+    every = _loop.runEvery(0.005, [&]
+                           {
+        if (++count == 3)
+        {
+            _loop.cancel(every);
+        } });
+    _loop.runAfter(0.05, [&]
+                   { _loop.quit(); });
+    _loop.loop();
+
+    EXPECT_EQ(count, 3);
+}
+
+// 测试超过第一层范围的定时器(时间轮需要逐层下放)
+TEST_P(TimerTest, LongDelay)
+{
+    Timestamp start = Timestamp::now();
+    Timestamp fired;
+    _loop.runAfter(0.3, [&]
+                   {
+        fired = Timestamp::now();
+        _loop.quit(); });
+    _loop.loop();
+
+    int64_t elapsed = fired.microseconds() - start.microseconds();
+    EXPECT_GE(elapsed, 300 * 1000);
+    EXPECT_LT(elapsed, 400 * 1000);
+}
+
+// 测试已有较晚的定时器时, 新加入的较早定时器仍能按时触发(timerfd需要提前)
+TEST_P(TimerTest, EarlierTimerAfterLater)
+{
+    Timestamp start = Timestamp::now();
+    Timestamp fired;
+    _loop.runAfter(1.0, [&]
+                   { _loop.quit(); });
+    _loop.runAfter(0.05, [&]
+                   {
+        // 在回调中再加入更早的定时器
+        _loop.runAfter(0.02, [&]
+                       {
+            fired = Timestamp::now();
+            _loop.quit(); }); });
+    _loop.loop();
+
+    int64_t elapsed = fired.microseconds() - start.microseconds();
+    EXPECT_GE(elapsed, 70 * 1000);
+    EXPECT_LT(elapsed, 200 * 1000);
+}
+
+// 参数: 是否使用时间轮, 是否使用timerfd
+INSTANTIATE_TEST_SUITE_P(TimerQueueAndWheel, TimerTest, testing::Values(make_tuple(false, true), make_tuple(true, true),
+                                                                          make_tuple(false, false), make_tuple(true, false)));
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,4 +1,5 @@
 #include "base/Timestamp.hpp"
+#include "log/Logger.hpp"
 
 #include <gtest/gtest.h>
 
@@ -27,6 +28,17 @@ TEST(TimestampTest, AddTime)
     EXPECT_LT(t2, t3);
 }
 
+// 测试日志时间缓存与 toString 结果一致, 包括跨秒的情况
+TEST(TimestampTest, LogFormatTime)
+{
+    const int64_t base = 1700000000LL * Timestamp::kMicroSecondsPerSecond;
+    for (int64_t delta : {0LL, 1LL, 999999LL, 1000000LL, 1000001LL, 59999999LL, 3600000007LL, 42LL})
+    {
+        Timestamp t(base + delta);
+        EXPECT_EQ(Logger::formatTime(t), t.toString());
+    }
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);